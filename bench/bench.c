@@ -0,0 +1,203 @@
+/**
+ * @file bench.c
+ * @brief Harness and entry point of the libmx microbenchmarks.
+ *
+ * Every mx_* function is timed next to its glibc counterpart where one
+ * exists. A row reports ns per operation, bytes per cycle (TSC cycles,
+ * x86 only) and heap allocations per operation. Allocations are counted
+ * by interposing malloc and friends, so the glibc side is accounted too.
+ *
+ * Usage: mx_bench [-o results.tsv] [-q] [group...]
+ *   -o  also write tab-separated rows to the file, for diffing runs
+ *   -q  quick mode, shorter timing windows
+ *   groups: mem string format utf8 sort containers io (default: all)
+ */
+
+#define _GNU_SOURCE
+#include "bench.h"
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#else
+#define BENCH_CYCLES() 0ULL
+#endif
+
+#define BENCH_RUNS 3
+
+static FILE *tsv = NULL;
+static double min_seconds = 0.05;
+static char **groups = NULL;
+static int n_groups = 0;
+
+// Allocation accounting through malloc interposition
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+extern void __libc_free(void *ptr);
+
+// Threaded benches allocate from several threads at once
+static atomic_size_t allocs = 0;
+
+#define COUNT_ALLOC() \
+    atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed)
+
+void *malloc(size_t size) {
+    COUNT_ALLOC();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    COUNT_ALLOC();
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    COUNT_ALLOC();
+    return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t align, size_t size) {
+    COUNT_ALLOC();
+    return __libc_memalign(align, size);
+}
+
+void *memalign(size_t align, size_t size) {
+    COUNT_ALLOC();
+    return __libc_memalign(align, size);
+}
+
+int posix_memalign(void **ptr, size_t align, size_t size) {
+    COUNT_ALLOC();
+    *ptr = __libc_memalign(align, size);
+    return *ptr ? 0 : 12;
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+bool bench_enabled(const char *group) {
+    if (n_groups == 0) {
+        return true;
+    }
+    for (int i = 0; i < n_groups; i++) {
+        if (strcmp(groups[i], group) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void bench_fill_random(char *buf, size_t len, int alphabet, unsigned seed) {
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = (char)('a' + (seed >> 16) % alphabet);
+    }
+}
+
+void bench_run(const t_bench_case *c, t_bench_fn fn, void *arg) {
+    size_t iters = 1;
+    double t;
+
+    // Double the count until one run fills a tenth of the window
+    while (true) {
+        t = now();
+        fn(arg, iters);
+        t = now() - t;
+        if (t >= min_seconds / 10 || iters >= ((size_t)1 << 40)) {
+            break;
+        }
+        iters *= 2;
+    }
+    iters = (size_t)(iters * (min_seconds / BENCH_RUNS) / (t > 0 ? t : 1e-9));
+    if (iters == 0) {
+        iters = 1;
+    }
+
+    double best = 1e30;
+    double best_cycles = 0;
+    size_t alloc_count = atomic_load_explicit(&allocs, memory_order_relaxed);
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        unsigned long long c0 = BENCH_CYCLES();
+        t = now();
+        fn(arg, iters);
+        t = now() - t;
+        unsigned long long c1 = BENCH_CYCLES();
+        if (t < best) {
+            best = t;
+            best_cycles = (double)(c1 - c0);
+        }
+    }
+    size_t alloc_total = atomic_load_explicit(&allocs, memory_order_relaxed);
+    double allocs_per_op = (double)(alloc_total - alloc_count)
+                           / ((double)iters * BENCH_RUNS);
+    double ns = best * 1e9 / iters;
+    double bpc = c->bytes && best_cycles > 0
+                 ? (double)c->bytes * iters / best_cycles : 0;
+
+    printf("%-10s %-18s %-5s %-28s %12.2f ns/op", c->group, c->name,
+           c->impl, c->param, ns);
+    if (bpc > 0) {
+        printf(" %8.2f B/cyc", bpc);
+    } else {
+        printf(" %14s", "");
+    }
+    printf(" %7.2f allocs/op\n", allocs_per_op);
+    fflush(stdout);
+    if (tsv != NULL) {
+        fprintf(tsv, "%s\t%s\t%s\t%s\t%.3f\t%.4f\t%.4f\n", c->group, c->name,
+                c->impl, c->param, ns, bpc, allocs_per_op);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *out = NULL;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (strcmp(argv[i], "-q") == 0) {
+            min_seconds = 0.01;
+        } else {
+            fprintf(stderr, "usage: %s [-o file.tsv] [-q] [group...]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    groups = argv + i;
+    n_groups = argc - i;
+
+    if (out != NULL) {
+        tsv = fopen(out, "w");
+        if (tsv == NULL) {
+            perror(out);
+            return 1;
+        }
+        fprintf(tsv, "group\tname\timpl\tparam\tns_per_op\tbytes_per_cycle"
+                     "\tallocs_per_op\n");
+    }
+
+    if (bench_enabled("mem")) bench_mem();
+    if (bench_enabled("string")) bench_string();
+    if (bench_enabled("format")) bench_format();
+    if (bench_enabled("utf8")) bench_utf8();
+    if (bench_enabled("sort")) bench_sort();
+    if (bench_enabled("containers")) bench_containers();
+    if (bench_enabled("io")) bench_io();
+
+    if (tsv != NULL) {
+        fclose(tsv);
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../inc/libmx.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Microbenchmark harness. A benchmark is a function that performs iters
+ * operations on a prepared argument; bench_run calibrates the iteration
+ * count, times the best of several runs and records one result row.
+ */
+
+typedef void (*t_bench_fn)(void *arg, size_t iters);
+
+typedef struct  s_bench_case {
+    const char *group;   // pack, e.g. "mem"
+    const char *name;    // operation, e.g. "memcpy"
+    const char *impl;    // "mx" or "libc"
+    char param[64];      // size, alignment, distribution...
+    size_t bytes;        // bytes processed per operation, 0 if n/a
+}               t_bench_case;
+
+void bench_run(const t_bench_case *c, t_bench_fn fn, void *arg);
+bool bench_enabled(const char *group);
+
+// Keeps a value alive so the compiler cannot drop the work producing it
+#define BENCH_KEEP(x) __asm__ volatile("" : : "g"(x) : "memory")
+
+void bench_fill_random(char *buf, size_t len, int alphabet, unsigned seed);
+
+void bench_mem(void);
+void bench_string(void);
+void bench_format(void);
+void bench_utf8(void);
+void bench_sort(void);
+void bench_containers(void);
+void bench_io(void);
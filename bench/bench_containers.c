@@ -0,0 +1,360 @@
+/**
+ * @file bench_containers.c
+ * @brief List, map, binary search, queue and arena benchmarks.
+ */
+
+#define _GNU_SOURCE
+#include "bench.h"
+#include <search.h>
+#include <pthread.h>
+
+#define KEYS_MAX 100000
+
+typedef struct  s_cont_arg {
+    char **keys;    // sorted
+    char **probes;  // keys in random order
+    size_t n;
+    t_mx_map *map;
+    struct hsearch_data htab;
+    t_mx_strindex *sorted;
+    t_mx_strindex *eytzinger;
+}               t_cont_arg;
+
+// Lists: build n elements at the back, then walk them
+
+static void run_list_push_back(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    while (iters--) {
+        t_list *list = NULL;
+        for (size_t i = 0; i < a->n; i++) {
+            mx_push_back(&list, a->keys[i]);
+        }
+        while (list != NULL) {
+            mx_pop_front(&list);
+        }
+    }
+}
+
+static void run_mx_list(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    while (iters--) {
+        t_mx_list list;
+        mx_list_init(&list);
+        for (size_t i = 0; i < a->n; i++) {
+            mx_list_push_back(&list, a->keys[i]);
+        }
+        for (t_list *node = list.head; node != NULL; node = node->next) {
+            BENCH_KEEP(node->data);
+        }
+        mx_list_clear(&list);
+    }
+}
+
+static void run_mx_list_pool(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    t_mx_node_pool *pool = mx_node_pool_new(0);
+    while (iters--) {
+        t_mx_list list;
+        mx_list_init_pool(&list, pool);
+        for (size_t i = 0; i < a->n; i++) {
+            mx_list_push_back(&list, a->keys[i]);
+        }
+        for (t_list *node = list.head; node != NULL; node = node->next) {
+            BENCH_KEEP(node->data);
+        }
+        mx_list_clear(&list);
+    }
+    mx_node_pool_del(&pool);
+}
+
+static void run_mx_ulist(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    while (iters--) {
+        t_mx_ulist list;
+        mx_ulist_init(&list);
+        for (size_t i = 0; i < a->n; i++) {
+            mx_ulist_push_back(&list, a->keys[i]);
+        }
+        t_mx_uiter it;
+        void *data;
+        mx_ulist_iter(&list, &it);
+        while (mx_ulist_next(&it, &data)) {
+            BENCH_KEEP(data);
+        }
+        mx_ulist_clear(&list);
+    }
+}
+
+// Lookups, one per operation, cycling through the shuffled keys
+
+static void run_mx_map_get(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(mx_map_get(a->map, a->probes[i % a->n]));
+    }
+}
+
+static void run_libc_hsearch(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    for (size_t i = 0; i < iters; i++) {
+        ENTRY e = {a->probes[i % a->n], NULL};
+        ENTRY *found = NULL;
+        hsearch_r(e, FIND, &found, &a->htab);
+        BENCH_KEEP(found);
+    }
+}
+
+static void run_mx_map_build(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    while (iters--) {
+        t_mx_map *map = mx_map_new(NULL);
+        for (size_t i = 0; i < a->n; i++) {
+            mx_map_set(map, a->probes[i], a->probes[i]);
+        }
+        mx_map_del(&map);
+    }
+}
+
+static void run_mx_binary_search(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    int count;
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(mx_binary_search(a->keys, (int)a->n,
+                                    a->probes[i % a->n], &count));
+    }
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void run_libc_bsearch(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(bsearch(&a->probes[i % a->n], a->keys, a->n,
+                           sizeof(char *), cmp_str));
+    }
+}
+
+static void run_mx_strindex_sorted(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(mx_strindex_find(a->sorted, a->probes[i % a->n]));
+    }
+}
+
+static void run_mx_strindex_eytzinger(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(mx_strindex_find(a->eytzinger, a->probes[i % a->n]));
+    }
+}
+
+// Batches of 64 lookups; the count stays in operations, not batches
+static void run_mx_strindex_batch(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    long out[64];
+    for (size_t i = 0; i < iters; i += 64) {
+        size_t at = i % a->n;
+        size_t m = a->n - at < 64 ? a->n - at : 64;
+        mx_strindex_find_batch(a->eytzinger, (const char *const *)a->probes
+                               + at, m, out);
+        BENCH_KEEP(out[0]);
+    }
+}
+
+// Queues: producers and consumers moving items through one queue
+
+#define QUEUE_THREADS 4
+
+typedef struct  s_queue_arg {
+    int kind;   // 0 mutex t_list, 1 mx_queue, 2 mx_ring
+    size_t per_thread;
+    pthread_mutex_t lock;
+    t_list *list;
+    t_mx_queue *queue;
+    t_mx_ring *ring;
+    size_t consumed;
+}               t_queue_arg;
+
+static bool queue_push(t_queue_arg *q, void *data) {
+    switch (q->kind) {
+    case 0:
+        pthread_mutex_lock(&q->lock);
+        mx_push_back(&q->list, data);
+        pthread_mutex_unlock(&q->lock);
+        return true;
+    case 1:
+        return mx_queue_push(q->queue, data) == 0;
+    default:
+        return mx_ring_push(q->ring, data);
+    }
+}
+
+static bool queue_pop(t_queue_arg *q) {
+    bool ok;
+    void *data;
+    switch (q->kind) {
+    case 0:
+        pthread_mutex_lock(&q->lock);
+        ok = q->list != NULL;
+        if (ok) {
+            mx_pop_front(&q->list);
+        }
+        pthread_mutex_unlock(&q->lock);
+        return ok;
+    case 1:
+        return mx_queue_pop(q->queue, &data);
+    default:
+        return mx_ring_pop(q->ring, &data);
+    }
+}
+
+static void *producer(void *p) {
+    t_queue_arg *q = p;
+    for (size_t i = 0; i < q->per_thread; i++) {
+        while (!queue_push(q, (void *)(i + 1))) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *consumer(void *p) {
+    t_queue_arg *q = p;
+    for (size_t i = 0; i < q->per_thread; i++) {
+        while (!queue_pop(q)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void run_queue(void *p, size_t iters) {
+    t_queue_arg *q = p;
+    pthread_t threads[2 * QUEUE_THREADS];
+
+    q->per_thread = iters / QUEUE_THREADS + 1;
+    for (int i = 0; i < QUEUE_THREADS; i++) {
+        pthread_create(&threads[2 * i], NULL, producer, q);
+        pthread_create(&threads[2 * i + 1], NULL, consumer, q);
+    }
+    for (int i = 0; i < 2 * QUEUE_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// Arena: many small allocations released at once
+
+static void run_mx_arena(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    t_mx_arena *arena = mx_arena_new(0);
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(mx_arena_strndup(arena, a->keys[i % a->n], 32));
+        if (i % 1024 == 1023) {
+            mx_arena_reset(arena);
+        }
+    }
+    mx_arena_del(&arena);
+}
+
+static void run_libc_strndup(void *p, size_t iters) {
+    t_cont_arg *a = p;
+    char *batch[1024];
+    for (size_t i = 0; i < iters; i++) {
+        batch[i % 1024] = strndup(a->keys[i % a->n], 32);
+        if (i % 1024 == 1023) {
+            for (int k = 0; k < 1024; k++) free(batch[k]);
+        }
+    }
+    for (size_t k = 0; k < iters % 1024; k++) free(batch[k]);
+}
+
+void bench_containers(void) {
+    static const size_t sizes[] = {1000, KEYS_MAX};
+    t_bench_case c = {"containers", "", "", "", 0};
+    t_cont_arg arg;
+    char *text = malloc(KEYS_MAX * 24);
+
+    arg.keys = malloc(KEYS_MAX * sizeof(char *));
+    arg.probes = malloc(KEYS_MAX * sizeof(char *));
+    for (size_t s = 0; s < 2; s++) {
+        arg.n = sizes[s];
+        for (size_t i = 0; i < arg.n; i++) {
+            arg.keys[i] = text + i * 24;
+            snprintf(arg.keys[i], 24, "metric.%08zu.count", i * 7919 % 99991);
+        }
+        qsort(arg.keys, arg.n, sizeof(char *), cmp_str);
+        memcpy(arg.probes, arg.keys, arg.n * sizeof(char *));
+        unsigned seed = 13;
+        for (size_t i = arg.n - 1; i > 0; i--) {
+            seed = seed * 1103515245u + 12345u;
+            size_t j = (seed >> 8) % (i + 1);
+            char *t = arg.probes[i];
+            arg.probes[i] = arg.probes[j];
+            arg.probes[j] = t;
+        }
+        arg.map = mx_map_new(NULL);
+        memset(&arg.htab, 0, sizeof(arg.htab));
+        hcreate_r(arg.n * 2, &arg.htab);
+        for (size_t i = 0; i < arg.n; i++) {
+            ENTRY e = {arg.keys[i], arg.keys[i]};
+            ENTRY *found;
+            mx_map_set(arg.map, arg.keys[i], arg.keys[i]);
+            hsearch_r(e, ENTER, &found, &arg.htab);
+        }
+        arg.sorted = mx_strindex_new(arg.keys, arg.n, false);
+        arg.eytzinger = mx_strindex_new(arg.keys, arg.n, true);
+        snprintf(c.param, sizeof(c.param), "n=%zu", arg.n);
+
+        static const struct {
+            const char *name;
+            const char *impl;
+            t_bench_fn fn;
+        } ops[] = {
+            {"map_get", "mx", run_mx_map_get},
+            {"map_get", "libc", run_libc_hsearch},
+            {"map_build", "mx", run_mx_map_build},
+            {"binary_search", "mx", run_mx_binary_search},
+            {"binary_search", "libc", run_libc_bsearch},
+            {"strindex_sorted", "mx", run_mx_strindex_sorted},
+            {"strindex_eytzinger", "mx", run_mx_strindex_eytzinger},
+            {"strindex_batch", "mx", run_mx_strindex_batch},
+            {"push_back", "mx", run_list_push_back},
+            {"list_push_back", "mx", run_mx_list},
+            {"list_push_pool", "mx", run_mx_list_pool},
+            {"ulist_push_back", "mx", run_mx_ulist},
+            {"arena_strndup", "mx", run_mx_arena},
+            {"arena_strndup", "libc", run_libc_strndup},
+        };
+        for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+            // The O(n^2) t_list append is only worth timing on short lists
+            if (ops[o].fn == run_list_push_back && arg.n > 1000) {
+                continue;
+            }
+            c.name = ops[o].name;
+            c.impl = ops[o].impl;
+            bench_run(&c, ops[o].fn, &arg);
+        }
+        mx_map_del(&arg.map);
+        hdestroy_r(&arg.htab);
+        mx_strindex_del(&arg.sorted);
+        mx_strindex_del(&arg.eytzinger);
+    }
+
+    static const char *kinds[] = {"mutex_list", "queue", "ring"};
+    for (int k = 0; k < 3; k++) {
+        t_queue_arg q = {k, 0, PTHREAD_MUTEX_INITIALIZER, NULL,
+                         mx_queue_new(), mx_ring_new(1024), 0};
+        t_bench_case qc = {"containers", "mpmc", k == 0 ? "libc" : "mx", "",
+                           0};
+        snprintf(qc.param, sizeof(qc.param), "%s threads=%dx%d", kinds[k],
+                 QUEUE_THREADS, QUEUE_THREADS);
+        bench_run(&qc, run_queue, &q);
+        mx_queue_del(&q.queue);
+        mx_ring_del(&q.ring);
+    }
+    free(arg.keys);
+    free(arg.probes);
+    free(text);
+}
@@ -0,0 +1,132 @@
+/**
+ * @file bench_io.c
+ * @brief File pack benchmarks: line reading and whole-file loading on a
+ *        temporary file, one operation being one pass over the file.
+ */
+
+#define _GNU_SOURCE
+#include "bench.h"
+#include <stdlib.h>
+
+#define IO_FILE_SIZE ((size_t)4 << 20)
+
+typedef struct  s_io_arg {
+    char path[64];
+    size_t size;
+}               t_io_arg;
+
+static void run_mx_read_line(void *p, size_t iters) {
+    t_io_arg *a = p;
+    while (iters--) {
+        int fd = open(a->path, O_RDONLY);
+        char *line = NULL;
+        while (mx_read_line(&line, 128, '\n', fd) >= 0) {
+            BENCH_KEEP(line);
+        }
+        free(line);
+        close(fd);
+    }
+}
+
+static void run_mx_reader_line(void *p, size_t iters) {
+    t_io_arg *a = p;
+    while (iters--) {
+        int fd = open(a->path, O_RDONLY);
+        t_mx_reader *reader = mx_reader_new(fd, 0);
+        char *line;
+        while (mx_reader_line(reader, &line) >= 0) {
+            BENCH_KEEP(line);
+        }
+        mx_reader_del(&reader);
+        close(fd);
+    }
+}
+
+static void run_libc_getline(void *p, size_t iters) {
+    t_io_arg *a = p;
+    while (iters--) {
+        FILE *f = fopen(a->path, "r");
+        char *line = NULL;
+        size_t cap = 0;
+        while (getline(&line, &cap, f) >= 0) {
+            BENCH_KEEP(line);
+        }
+        free(line);
+        fclose(f);
+    }
+}
+
+static void run_mx_file_to_str(void *p, size_t iters) {
+    t_io_arg *a = p;
+    while (iters--) {
+        free(mx_file_to_str(a->path));
+    }
+}
+
+static void run_mx_file_view(void *p, size_t iters) {
+    t_io_arg *a = p;
+    while (iters--) {
+        t_mx_view view;
+        if (mx_file_view(a->path, &view) == 0) {
+            BENCH_KEEP(view.data[view.len / 2]);
+            mx_view_release(&view);
+        }
+    }
+}
+
+static void run_libc_fread(void *p, size_t iters) {
+    t_io_arg *a = p;
+    while (iters--) {
+        FILE *f = fopen(a->path, "r");
+        char *buf = malloc(a->size + 1);
+        buf[fread(buf, 1, a->size, f)] = '\0';
+        free(buf);
+        fclose(f);
+    }
+}
+
+void bench_io(void) {
+    static const size_t line_lens[] = {40, 400};
+    t_bench_case c = {"io", "", "", "", IO_FILE_SIZE};
+    t_io_arg arg = {"/tmp/mx_bench_XXXXXX", IO_FILE_SIZE};
+    char *text = malloc(IO_FILE_SIZE);
+
+    for (size_t l = 0; l < 2; l++) {
+        int fd = mkstemp(arg.path);
+        if (fd < 0) {
+            perror("mkstemp");
+            break;
+        }
+        bench_fill_random(text, IO_FILE_SIZE, 26, 17);
+        for (size_t i = line_lens[l]; i < IO_FILE_SIZE; i += line_lens[l]) {
+            text[i] = '\n';
+        }
+        if (write(fd, text, IO_FILE_SIZE) != (ssize_t)IO_FILE_SIZE) {
+            perror("write");
+        }
+        close(fd);
+        snprintf(c.param, sizeof(c.param), "size=%zu line=%zu",
+                 IO_FILE_SIZE, line_lens[l]);
+
+        c.name = "read_line";
+        c.impl = "mx";
+        bench_run(&c, run_mx_read_line, &arg);
+        c.name = "reader_line";
+        bench_run(&c, run_mx_reader_line, &arg);
+        c.name = "read_line";
+        c.impl = "libc";
+        bench_run(&c, run_libc_getline, &arg);
+        c.name = "file_to_str";
+        c.impl = "mx";
+        bench_run(&c, run_mx_file_to_str, &arg);
+        c.name = "file_view";
+        bench_run(&c, run_mx_file_view, &arg);
+        c.name = "file_to_str";
+        c.impl = "libc";
+        bench_run(&c, run_libc_fread, &arg);
+
+        unlink(arg.path);
+        snprintf(arg.path, sizeof(arg.path), "/tmp/mx_bench_XXXXXX");
+    }
+    free(text);
+}
@@ -0,0 +1,143 @@
+/**
+ * @file bench_mem.c
+ * @brief Memory pack benchmarks: sizes from 8 B to 1 MiB, aligned and
+ *        misaligned buffers.
+ */
+
+#define _GNU_SOURCE
+#include "bench.h"
+
+#define MEM_MAX ((size_t)1 << 20)
+
+typedef struct  s_mem_arg {
+    char *dst;
+    char *src;
+    size_t n;
+}               t_mem_arg;
+
+static void run_mx_memcpy(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(mx_memcpy(a->dst, a->src, a->n));
+    }
+}
+
+static void run_libc_memcpy(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(memcpy(a->dst, a->src, a->n));
+    }
+}
+
+static void run_mx_memmove(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(mx_memmove(a->dst, a->dst + 1, a->n));
+    }
+}
+
+static void run_libc_memmove(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(memmove(a->dst, a->dst + 1, a->n));
+    }
+}
+
+static void run_mx_memset(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(mx_memset(a->dst, 'x', a->n));
+    }
+}
+
+static void run_libc_memset(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(memset(a->dst, 'x', a->n));
+    }
+}
+
+// dst holds a copy of src, so the whole length is compared
+static void run_mx_memcmp(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(mx_memcmp(a->dst, a->src, a->n));
+    }
+}
+
+static void run_libc_memcmp(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(memcmp(a->dst, a->src, a->n));
+    }
+}
+
+// src holds no '#', so the whole length is scanned
+static void run_mx_memchr(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(mx_memchr(a->src, '#', a->n));
+    }
+}
+
+static void run_libc_memchr(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(memchr(a->src, '#', a->n));
+    }
+}
+
+static void run_mx_memmem(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(mx_memmem(a->src, a->n, "zzzzzz!", 7));
+    }
+}
+
+static void run_libc_memmem(void *p, size_t iters) {
+    t_mem_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(memmem(a->src, a->n, "zzzzzz!", 7));
+    }
+}
+
+static const struct {
+    const char *name;
+    t_bench_fn mx;
+    t_bench_fn libc;
+} mem_ops[] = {
+    {"memcpy", run_mx_memcpy, run_libc_memcpy},
+    {"memmove", run_mx_memmove, run_libc_memmove},
+    {"memset", run_mx_memset, run_libc_memset},
+    {"memcmp", run_mx_memcmp, run_libc_memcmp},
+    {"memchr", run_mx_memchr, run_libc_memchr},
+    {"memmem", run_mx_memmem, run_libc_memmem},
+};
+
+void bench_mem(void) {
+    // The sizes under 64 run the SSE2 tails of the AVX2 kernels
+    static const size_t sizes[] = {8, 16, 31, 48, 64, 512, 4096, 65536,
+                                   MEM_MAX};
+    static const size_t aligns[][2] = {{0, 0}, {1, 3}};
+    char *dst = malloc(MEM_MAX + 128);
+    char *src = malloc(MEM_MAX + 128);
+
+    bench_fill_random(src, MEM_MAX + 128, 26, 1);
+    for (size_t o = 0; o < sizeof(mem_ops) / sizeof(mem_ops[0]); o++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            for (size_t al = 0; al < 2; al++) {
+                t_mem_arg arg = {dst + 64 + aligns[al][0],
+                                 src + 64 + aligns[al][1], sizes[s]};
+                memcpy(arg.dst, arg.src, arg.n);
+                t_bench_case c = {"mem", mem_ops[o].name, "mx", "", sizes[s]};
+                snprintf(c.param, sizeof(c.param), "n=%zu align=%zu/%zu",
+                         sizes[s], aligns[al][0], aligns[al][1]);
+                bench_run(&c, mem_ops[o].mx, &arg);
+                c.impl = "libc";
+                bench_run(&c, mem_ops[o].libc, &arg);
+            }
+        }
+    }
+    free(dst);
+    free(src);
+}
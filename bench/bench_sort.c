@@ -0,0 +1,183 @@
+/**
+ * @file bench_sort.c
+ * @brief Sort pack benchmarks on random, sorted, reversed and
+ *        few-distinct inputs. Every operation copies the input back
+ *        first, for both implementations alike.
+ */
+
+#define _GNU_SOURCE
+#include "bench.h"
+
+typedef struct  s_sort_arg {
+    int *ints;
+    int *work;
+    char **strs;
+    char **swork;
+    t_list *nodes;
+    size_t n;
+}               t_sort_arg;
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static bool after_int(void *a, void *b) {
+    return *(int *)a > *(int *)b;
+}
+
+static void run_mx_sort(void *p, size_t iters) {
+    t_sort_arg *a = p;
+    while (iters--) {
+        memcpy(a->work, a->ints, a->n * sizeof(int));
+        mx_sort(a->work, a->n, sizeof(int), cmp_int);
+    }
+}
+
+static void run_mx_stable_sort(void *p, size_t iters) {
+    t_sort_arg *a = p;
+    while (iters--) {
+        memcpy(a->work, a->ints, a->n * sizeof(int));
+        BENCH_KEEP(mx_stable_sort(a->work, a->n, sizeof(int), cmp_int));
+    }
+}
+
+static void run_libc_qsort(void *p, size_t iters) {
+    t_sort_arg *a = p;
+    while (iters--) {
+        memcpy(a->work, a->ints, a->n * sizeof(int));
+        qsort(a->work, a->n, sizeof(int), cmp_int);
+    }
+}
+
+static void run_mx_sort_strarr(void *p, size_t iters) {
+    t_sort_arg *a = p;
+    while (iters--) {
+        memcpy(a->swork, a->strs, a->n * sizeof(char *));
+        mx_sort_strarr(a->swork, a->n);
+    }
+}
+
+static void run_mx_quicksort(void *p, size_t iters) {
+    t_sort_arg *a = p;
+    while (iters--) {
+        memcpy(a->swork, a->strs, a->n * sizeof(char *));
+        BENCH_KEEP(mx_quicksort(a->swork, 0, (int)a->n - 1));
+    }
+}
+
+static void run_mx_bubble_sort(void *p, size_t iters) {
+    t_sort_arg *a = p;
+    while (iters--) {
+        memcpy(a->swork, a->strs, a->n * sizeof(char *));
+        BENCH_KEEP(mx_bubble_sort(a->swork, (int)a->n));
+    }
+}
+
+static void run_libc_qsort_str(void *p, size_t iters) {
+    t_sort_arg *a = p;
+    while (iters--) {
+        memcpy(a->swork, a->strs, a->n * sizeof(char *));
+        qsort(a->swork, a->n, sizeof(char *), cmp_str);
+    }
+}
+
+// Relinks the preallocated nodes in input order before every sort
+static t_list *relink(t_sort_arg *a) {
+    for (size_t i = 0; i < a->n; i++) {
+        a->nodes[i].data = &a->ints[i];
+        a->nodes[i].next = i + 1 < a->n ? &a->nodes[i + 1] : NULL;
+    }
+    return a->nodes;
+}
+
+static void run_mx_sort_list(void *p, size_t iters) {
+    t_sort_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(mx_sort_list(relink(a), after_int));
+    }
+}
+
+static void run_mx_list_merge_sort(void *p, size_t iters) {
+    t_sort_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(mx_list_merge_sort(relink(a), after_int));
+    }
+}
+
+static const char *dists[] = {"random", "sorted", "reversed", "few"};
+
+static void fill_dist(int *v, size_t n, int dist) {
+    unsigned seed = 11;
+    for (size_t i = 0; i < n; i++) {
+        seed = seed * 1103515245u + 12345u;
+        v[i] = dist == 0 ? (int)(seed >> 1)
+               : dist == 1 ? (int)i
+               : dist == 2 ? (int)(n - i)
+               : (int)((seed >> 16) % 8);
+    }
+}
+
+void bench_sort(void) {
+    static const size_t sizes[] = {1000, 100000};
+    t_bench_case c = {"sort", "", "", "", 0};
+    size_t max = 100000;
+    t_sort_arg arg;
+
+    arg.ints = malloc(max * sizeof(int));
+    arg.work = malloc(max * sizeof(int));
+    arg.strs = malloc(max * sizeof(char *));
+    arg.swork = malloc(max * sizeof(char *));
+    arg.nodes = malloc(max * sizeof(t_list));
+    char *text = malloc(max * 16);
+
+    for (size_t s = 0; s < 2; s++) {
+        for (int d = 0; d < 4; d++) {
+            arg.n = sizes[s];
+            fill_dist(arg.ints, arg.n, d);
+            // Strings share an 8-byte prefix, the realistic hard case
+            for (size_t i = 0; i < arg.n; i++) {
+                arg.strs[i] = text + i * 16;
+                snprintf(arg.strs[i], 16, "key_%010u", (unsigned)arg.ints[i]);
+            }
+            snprintf(c.param, sizeof(c.param), "n=%zu %s", arg.n, dists[d]);
+
+            c.name = "sort_int";
+            c.impl = "mx";
+            bench_run(&c, run_mx_sort, &arg);
+            c.name = "stable_sort_int";
+            bench_run(&c, run_mx_stable_sort, &arg);
+            c.name = "sort_int";
+            c.impl = "libc";
+            bench_run(&c, run_libc_qsort, &arg);
+
+            c.name = "sort_strarr";
+            c.impl = "mx";
+            bench_run(&c, run_mx_sort_strarr, &arg);
+            c.name = "quicksort";
+            bench_run(&c, run_mx_quicksort, &arg);
+            c.name = "bubble_sort";
+            bench_run(&c, run_mx_bubble_sort, &arg);
+            c.name = "sort_strarr";
+            c.impl = "libc";
+            bench_run(&c, run_libc_qsort_str, &arg);
+
+            c.impl = "mx";
+            c.name = "sort_list";
+            bench_run(&c, run_mx_sort_list, &arg);
+            c.name = "list_merge_sort";
+            bench_run(&c, run_mx_list_merge_sort, &arg);
+        }
+    }
+    free(arg.ints);
+    free(arg.work);
+    free(arg.strs);
+    free(arg.swork);
+    free(arg.nodes);
+    free(text);
+}
@@ -0,0 +1,545 @@
+/**
+ * @file bench_string.c
+ * @brief String, search, split, format and UTF-8 pack benchmarks.
+ *
+ * Text is drawn from 4-letter and 26-letter alphabets: the small one
+ * makes partial needle matches frequent, the large one rare.
+ */
+
+#define _GNU_SOURCE
+#include "bench.h"
+#include <stdlib.h>
+#include <inttypes.h>
+#include <locale.h>
+#include <wchar.h>
+
+typedef struct  s_str_arg {
+    char *a;
+    char *b;
+    char *buf;
+    const char *needle;
+    size_t n;
+}               t_str_arg;
+
+static void run_mx_strlen(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(mx_strlen(a->a));
+}
+
+static void run_libc_strlen(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(strlen(a->a));
+}
+
+static void run_mx_strcmp(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(mx_strcmp(a->a, a->b));
+}
+
+static void run_libc_strcmp(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(strcmp(a->a, a->b));
+}
+
+static void run_mx_strcpy(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(mx_strcpy(a->buf, a->a));
+}
+
+static void run_libc_strcpy(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(strcpy(a->buf, a->a));
+}
+
+static void run_mx_strchr(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(mx_get_char_index(a->a, '#'));
+}
+
+static void run_libc_strchr(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(strchr(a->a, '#'));
+}
+
+static void run_mx_strdup(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) free(mx_strdup(a->a));
+}
+
+static void run_libc_strdup(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) free(strdup(a->a));
+}
+
+static void run_mx_strstr(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(mx_strstr(a->a, a->needle));
+}
+
+static void run_libc_strstr(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(strstr(a->a, a->needle));
+}
+
+static void run_mx_count_substr(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) BENCH_KEEP(mx_count_substr(a->a, a->needle));
+}
+
+static void run_mx_replace_substr(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) free(mx_replace_substr(a->a, a->needle, "<>"));
+}
+
+static void run_mx_strsplit(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) {
+        char **words = mx_strsplit(a->a, 'a');
+        mx_del_strarr(&words);
+    }
+}
+
+// strtok_r on a copy, keeping every token like mx_strsplit does
+static void run_libc_strsplit(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) {
+        char *copy = strdup(a->a);
+        char *save = NULL;
+        size_t n = 0;
+        size_t cap = 16;
+        char **words = malloc(cap * sizeof(char *));
+        for (char *w = strtok_r(copy, "a", &save); w != NULL;
+             w = strtok_r(NULL, "a", &save)) {
+            if (n + 1 == cap) {
+                words = realloc(words, (cap *= 2) * sizeof(char *));
+            }
+            words[n++] = strdup(w);
+        }
+        while (n > 0) free(words[--n]);
+        free(words);
+        free(copy);
+    }
+}
+
+// Builds "<i>," for every piece, the way output is assembled piecemeal
+static void run_mx_strjoin_build(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) {
+        char *out = mx_strnew(0);
+        for (size_t i = 0; i < a->n; i++) {
+            char *num = mx_itoa((int)i);
+            char *tmp = mx_strjoin(out, num);
+            free(out);
+            out = mx_strjoin(tmp, ",");
+            free(tmp);
+            free(num);
+        }
+        free(out);
+    }
+}
+
+static void run_mx_str_build(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) {
+        t_mx_str out;
+        mx_str_init(&out);
+        for (size_t i = 0; i < a->n; i++) {
+            mx_str_cat_int(&out, (int64_t)i);
+            mx_str_cat_char(&out, ',');
+        }
+        free(mx_str_release(&out));
+    }
+}
+
+static void run_mx_del_extra_spaces(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) {
+        free(mx_del_extra_spaces(a->a));
+    }
+}
+
+static void run_mx_del_extra_spaces_inplace(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) {
+        memcpy(a->buf, a->a, a->n + 1);
+        BENCH_KEEP(mx_del_extra_spaces_inplace(a->buf, a->n));
+    }
+}
+
+// Normalizes in 4096-byte chunks, as when reading a stream
+static void run_mx_space_norm(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) {
+        t_mx_space_norm st;
+        size_t out = 0;
+        mx_space_norm_init(&st);
+        for (size_t i = 0; i < a->n; i += 4096) {
+            size_t len = a->n - i < 4096 ? a->n - i : 4096;
+            out += mx_space_norm(&st, a->a + i, len, a->buf + out);
+        }
+        BENCH_KEEP(out);
+    }
+}
+
+// The byte-at-a-time loop mx_del_extra_spaces used to run
+static void run_scalar_del_extra_spaces(void *p, size_t iters) {
+    t_str_arg *a = p;
+    while (iters--) {
+        size_t j = 0;
+        bool gap = false;
+        for (size_t i = 0; i < a->n; i++) {
+            char ch = a->a[i];
+            if (ch == ' ' || ch == '\n' || ch == '\t' || ch == '\f') {
+                gap = true;
+                continue;
+            }
+            if (gap && j > 0) {
+                a->buf[j++] = ' ';
+            }
+            a->buf[j++] = ch;
+            gap = false;
+        }
+        BENCH_KEEP(j);
+    }
+}
+
+void bench_string(void) {
+    static const size_t sizes[] = {16, 256, 4096, 65536};
+    size_t max = 65536 + 64;
+    char *a = malloc(max);
+    char *b = malloc(max);
+    char *buf = malloc(max);
+    t_bench_case c = {"string", "", "", "", 0};
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t off = 0; off < 2; off++) {
+            size_t n = sizes[s];
+            t_str_arg arg = {a + off * 5, b, buf + off * 3, NULL, n};
+            bench_fill_random(arg.a, n, 26, 2);
+            arg.a[n] = '\0';
+            memcpy(arg.b, arg.a, n + 1);
+            snprintf(c.param, sizeof(c.param), "n=%zu align=%zu", n, off * 5);
+            c.bytes = n;
+
+            static const struct {
+                const char *name;
+                t_bench_fn mx;
+                t_bench_fn libc;
+            } ops[] = {
+                {"strlen", run_mx_strlen, run_libc_strlen},
+                {"strcmp", run_mx_strcmp, run_libc_strcmp},
+                {"strcpy", run_mx_strcpy, run_libc_strcpy},
+                {"get_char_index", run_mx_strchr, run_libc_strchr},
+                {"strdup", run_mx_strdup, run_libc_strdup},
+            };
+            for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+                c.name = ops[o].name;
+                c.impl = "mx";
+                bench_run(&c, ops[o].mx, &arg);
+                c.impl = "libc";
+                bench_run(&c, ops[o].libc, &arg);
+            }
+        }
+    }
+
+    // Needle search over random text, the needle absent from it
+    static const int alphabets[] = {4, 26};
+    static const size_t needles[] = {4, 16, 64};
+    for (size_t al = 0; al < 2; al++) {
+        for (size_t nl = 0; nl < 3; nl++) {
+            size_t n = 65536;
+            char needle[80];
+            bench_fill_random(a, n, alphabets[al], 3);
+            a[n] = '\0';
+            bench_fill_random(needle, needles[nl], alphabets[al], 4);
+            needle[needles[nl] - 1] = 'z' + 1;
+            needle[needles[nl]] = '\0';
+            t_str_arg arg = {a, NULL, NULL, needle, n};
+            snprintf(c.param, sizeof(c.param), "n=%zu alpha=%d needle=%zu",
+                     n, alphabets[al], needles[nl]);
+            c.bytes = n;
+            c.name = "strstr";
+            c.impl = "mx";
+            bench_run(&c, run_mx_strstr, &arg);
+            c.impl = "libc";
+            bench_run(&c, run_libc_strstr, &arg);
+            c.name = "count_substr";
+            c.impl = "mx";
+            bench_run(&c, run_mx_count_substr, &arg);
+        }
+    }
+
+    // Replacement and splitting where matches do occur
+    for (size_t s = 1; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        bench_fill_random(a, n, 4, 5);
+        a[n] = '\0';
+        t_str_arg arg = {a, NULL, NULL, "abc", n};
+        snprintf(c.param, sizeof(c.param), "n=%zu alpha=4", n);
+        c.bytes = n;
+        c.name = "replace_substr";
+        c.impl = "mx";
+        bench_run(&c, run_mx_replace_substr, &arg);
+        c.name = "strsplit";
+        bench_run(&c, run_mx_strsplit, &arg);
+        c.impl = "libc";
+        bench_run(&c, run_libc_strsplit, &arg);
+    }
+
+    // Whitespace normalization on word-like text, ws = whitespace share
+    for (size_t s = 1; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (int sparse = 0; sparse < 2; sparse++) {
+            size_t n = sizes[s];
+            bench_fill_random(a, n, sparse ? 26 : 8, 6);
+            for (size_t i = 0; i < n; i++) {
+                if (a[i] == 'e') a[i] = ' ';
+                if (a[i] == 'f') a[i] = '\n';
+            }
+            a[n] = '\0';
+            t_str_arg arg = {a, NULL, buf, NULL, n};
+            snprintf(c.param, sizeof(c.param), "n=%zu ws=%d%%", n,
+                     sparse ? 8 : 25);
+            c.bytes = n;
+            c.impl = "mx";
+            c.name = "del_extra_spaces";
+            bench_run(&c, run_mx_del_extra_spaces, &arg);
+            c.impl = "scalar";
+            bench_run(&c, run_scalar_del_extra_spaces, &arg);
+            c.impl = "mx";
+            c.name = "del_extra_spaces_inplace";
+            bench_run(&c, run_mx_del_extra_spaces_inplace, &arg);
+            c.name = "space_norm";
+            bench_run(&c, run_mx_space_norm, &arg);
+        }
+    }
+
+    // Quadratic joining against the amortized builder
+    for (size_t pieces = 16; pieces <= 4096; pieces *= 16) {
+        t_str_arg arg = {NULL, NULL, NULL, NULL, pieces};
+        snprintf(c.param, sizeof(c.param), "pieces=%zu", pieces);
+        c.bytes = 0;
+        c.impl = "mx";
+        c.name = "build_strjoin";
+        bench_run(&c, run_mx_strjoin_build, &arg);
+        c.name = "build_str";
+        bench_run(&c, run_mx_str_build, &arg);
+    }
+    free(a);
+    free(b);
+    free(buf);
+}
+
+#define FMT_VALUES 1024
+
+typedef struct  s_fmt_arg {
+    int64_t values[FMT_VALUES];
+    char text[FMT_VALUES][MX_NBR_BUF];
+}               t_fmt_arg;
+
+static void run_mx_i64_to_buf(void *p, size_t iters) {
+    t_fmt_arg *a = p;
+    char buf[MX_NBR_BUF];
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(mx_i64_to_buf(a->values[i % FMT_VALUES], buf));
+    }
+}
+
+static void run_libc_i64_to_buf(void *p, size_t iters) {
+    t_fmt_arg *a = p;
+    char buf[MX_NBR_BUF];
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(snprintf(buf, sizeof(buf), "%" PRId64,
+                            a->values[i % FMT_VALUES]));
+    }
+}
+
+static void run_mx_hex_to_buf(void *p, size_t iters) {
+    t_fmt_arg *a = p;
+    char buf[MX_NBR_BUF];
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(mx_hex_to_buf((uint64_t)a->values[i % FMT_VALUES], buf));
+    }
+}
+
+static void run_libc_hex_to_buf(void *p, size_t iters) {
+    t_fmt_arg *a = p;
+    char buf[MX_NBR_BUF];
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(snprintf(buf, sizeof(buf), "%" PRIx64,
+                            (uint64_t)a->values[i % FMT_VALUES]));
+    }
+}
+
+static void run_mx_itoa(void *p, size_t iters) {
+    t_fmt_arg *a = p;
+    for (size_t i = 0; i < iters; i++) {
+        free(mx_itoa((int)a->values[i % FMT_VALUES]));
+    }
+}
+
+static void run_mx_parse_hex(void *p, size_t iters) {
+    t_fmt_arg *a = p;
+    uint64_t v;
+    for (size_t i = 0; i < iters; i++) {
+        mx_parse_hex(a->text[i % FMT_VALUES], &v, NULL);
+        BENCH_KEEP(v);
+    }
+}
+
+static void run_libc_parse_hex(void *p, size_t iters) {
+    t_fmt_arg *a = p;
+    for (size_t i = 0; i < iters; i++) {
+        BENCH_KEEP(strtoull(a->text[i % FMT_VALUES], NULL, 16));
+    }
+}
+
+void bench_format(void) {
+    t_fmt_arg *arg = malloc(sizeof(t_fmt_arg));
+    t_bench_case c = {"format", "", "", "", 0};
+    static const char *dists[] = {"small", "int32", "int64"};
+    unsigned seed = 7;
+
+    for (int d = 0; d < 3; d++) {
+        for (int i = 0; i < FMT_VALUES; i++) {
+            seed = seed * 1103515245u + 12345u;
+            uint64_t r = ((uint64_t)seed << 32) ^ (seed * 2654435761u);
+            arg->values[i] = d == 0 ? (int64_t)(r % 1000)
+                             : d == 1 ? (int64_t)(int32_t)r : (int64_t)r;
+            mx_hex_to_buf((uint64_t)arg->values[i], arg->text[i]);
+        }
+        snprintf(c.param, sizeof(c.param), "values=%s", dists[d]);
+        c.name = "i64_to_buf";
+        c.impl = "mx";
+        bench_run(&c, run_mx_i64_to_buf, arg);
+        c.impl = "libc";
+        bench_run(&c, run_libc_i64_to_buf, arg);
+        c.name = "hex_to_buf";
+        c.impl = "mx";
+        bench_run(&c, run_mx_hex_to_buf, arg);
+        c.impl = "libc";
+        bench_run(&c, run_libc_hex_to_buf, arg);
+        c.name = "parse_hex";
+        c.impl = "mx";
+        bench_run(&c, run_mx_parse_hex, arg);
+        c.impl = "libc";
+        bench_run(&c, run_libc_parse_hex, arg);
+        c.name = "itoa";
+        c.impl = "mx";
+        bench_run(&c, run_mx_itoa, arg);
+    }
+    free(arg);
+}
+
+#define U8_TEXT (64 << 10)
+
+typedef struct  s_u8_arg {
+    char *text;       // '\0'-terminated, for the libc side
+    size_t len;
+    wchar_t *wide;
+    size_t n_wide;
+    char *out;
+}               t_u8_arg;
+
+static void run_mx_utf8_validate(void *p, size_t iters) {
+    t_u8_arg *a = p;
+    while (iters--) BENCH_KEEP(mx_utf8_validate(a->text, a->len));
+}
+
+static void run_libc_utf8_validate(void *p, size_t iters) {
+    t_u8_arg *a = p;
+    while (iters--) BENCH_KEEP(mbstowcs(NULL, a->text, 0));
+}
+
+static void run_mx_utf8_count(void *p, size_t iters) {
+    t_u8_arg *a = p;
+    while (iters--) BENCH_KEEP(mx_utf8_count(a->text, a->len));
+}
+
+static void run_mx_utf8_to_wcs(void *p, size_t iters) {
+    t_u8_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(mx_utf8_to_wcs(a->text, a->len, a->wide, a->n_wide + 1));
+    }
+}
+
+static void run_libc_utf8_to_wcs(void *p, size_t iters) {
+    t_u8_arg *a = p;
+    while (iters--) BENCH_KEEP(mbstowcs(a->wide, a->text, a->n_wide + 1));
+}
+
+static void run_mx_wcs_to_utf8(void *p, size_t iters) {
+    t_u8_arg *a = p;
+    while (iters--) {
+        BENCH_KEEP(mx_wcs_to_utf8(a->wide, a->n_wide, a->out, a->len + 1));
+    }
+}
+
+static void run_libc_wcs_to_utf8(void *p, size_t iters) {
+    t_u8_arg *a = p;
+    while (iters--) BENCH_KEEP(wcstombs(a->out, a->wide, a->len + 1));
+}
+
+// Text where roughly one code point in `every` is drawn from [lo, hi)
+static void u8_fill(t_u8_arg *a, uint32_t lo, uint32_t hi, int every) {
+    unsigned seed = 11;
+    size_t len = 0;
+
+    while (len + MX_UTF8_MAX < U8_TEXT) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t cp = 'a' + (seed >> 16) % 26;
+        if (every && (seed >> 8) % every == 0) {
+            cp = lo + (seed >> 4) % (hi - lo);
+        }
+        len += mx_utf8_encode(cp, a->text + len);
+    }
+    a->text[len] = '\0';
+    a->len = len;
+    a->n_wide = (size_t)mx_utf8_to_wcs(a->text, len, a->wide, U8_TEXT);
+    a->wide[a->n_wide] = L'\0';
+}
+
+void bench_utf8(void) {
+    t_u8_arg a = {malloc(U8_TEXT), 0, malloc((U8_TEXT + 1) * sizeof(wchar_t)),
+                  0, malloc(U8_TEXT)};
+    t_bench_case c = {"utf8", "", "", "", 0};
+    static const struct {
+        const char *name;
+        uint32_t lo;
+        uint32_t hi;
+        int every;
+    } texts[] = {
+        {"ascii", 0, 0, 0},
+        {"latin", 0xC0, 0x180, 4},
+        {"cjk", 0x4E00, 0x9FFF, 1},
+        {"emoji", 0x1F300, 0x1F650, 2},
+    };
+
+    if (setlocale(LC_CTYPE, "C.UTF-8") == NULL) {
+        setlocale(LC_CTYPE, "en_US.UTF-8");
+    }
+    for (size_t t = 0; t < sizeof(texts) / sizeof(texts[0]); t++) {
+        u8_fill(&a, texts[t].lo, texts[t].hi, texts[t].every);
+        snprintf(c.param, sizeof(c.param), "text=%s", texts[t].name);
+        c.bytes = a.len;
+        c.name = "validate";
+        c.impl = "mx";
+        bench_run(&c, run_mx_utf8_validate, &a);
+        c.impl = "libc";
+        bench_run(&c, run_libc_utf8_validate, &a);
+        c.name = "count";
+        c.impl = "mx";
+        bench_run(&c, run_mx_utf8_count, &a);
+        c.name = "to_wcs";
+        bench_run(&c, run_mx_utf8_to_wcs, &a);
+        c.impl = "libc";
+        bench_run(&c, run_libc_utf8_to_wcs, &a);
+        c.name = "from_wcs";
+        c.impl = "mx";
+        bench_run(&c, run_mx_wcs_to_utf8, &a);
+        c.impl = "libc";
+        bench_run(&c, run_libc_wcs_to_utf8, &a);
+    }
+    free(a.text);
+    free(a.wide);
+    free(a.out);
+}
@@ -4,13 +4,20 @@
 #include <malloc.h>
 #include <unistd.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #define INT_MIN -2147483648
 #define INT_MAX 2147483647
 
 // Allowed funclions
-// malloc, malloc_usable_size, free, open, read, write, close, exit
+// malloc, malloc_usable_size, free, open, read, write, close, exit,
+// fstat, mmap, munmap, writev, atexit, aligned_alloc, tss_create,
+// tss_set
 
 // Utils pack
 // implementation in mx_utils.c
@@ -30,6 +37,53 @@ int mx_binary_search(char **arr, int size, const char *s, int *count);
 int mx_bubble_sort(char **arr, int size);
 int mx_quicksort(char **arr, int left, int right);
 
+// Format pack
+// implementation in mx_format.c
+
+// Big enough for any 64-bit number in base 10 or 16, sign and '\0'
+#define MX_NBR_BUF 21
+// Big enough for any 64-bit number in any base and '\0'
+#define MX_BASE_BUF 65
+
+size_t mx_u64_to_buf(uint64_t n, char *buf);
+size_t mx_i64_to_buf(int64_t n, char *buf);
+size_t mx_hex_to_buf(uint64_t n, char *buf);
+size_t mx_base_to_buf(uint64_t n, unsigned int base, char *buf);
+int mx_parse_hex(const char *s, uint64_t *nbr, const char **end);
+
+// UTF-8 pack
+// implementation in mx_utf8.c
+
+// Longest UTF-8 encoding of one code point
+#define MX_UTF8_MAX 4
+
+size_t mx_utf8_encode(uint32_t cp, char *buf);
+int mx_utf8_decode(const char *s, size_t len, uint32_t *cp);
+size_t mx_utf8_validate(const char *s, size_t len);
+bool mx_utf8_valid(const char *s, size_t len);
+size_t mx_utf8_count(const char *s, size_t len);
+long mx_utf8_to_utf32(const char *s, size_t len, uint32_t *out,
+                      size_t out_len);
+long mx_utf32_to_utf8(const uint32_t *in, size_t n, char *out,
+                      size_t out_len);
+long mx_utf8_to_wcs(const char *s, size_t len, wchar_t *out, size_t out_len);
+long mx_wcs_to_utf8(const wchar_t *in, size_t n, char *out, size_t out_len);
+
+// Output pack
+// implementation in mx_output.c
+
+// Unbuffered (MX_OUT_NONE) by default; buffered modes are not thread-safe
+typedef enum    e_mx_out_mode {
+    MX_OUT_NONE,
+    MX_OUT_LINE,
+    MX_OUT_FULL
+}               t_mx_out_mode;
+
+int mx_out_setbuf(size_t size, t_mx_out_mode mode);
+void mx_out_write(const void *data, size_t len);
+void mx_out_putc(char c);
+void mx_out_flush(void);
+
 // String pack
 // implementation in mx_string.c
 
@@ -56,6 +110,8 @@ char **mx_strsplit(const char *s, char c);
 char *mx_strjoin(const char *s1, const char *s2);
 char *mx_file_to_str(const char *file);
 char *mx_replace_substr(const char *str, const char *sub, const char *replace);
+char *mx_replace_substrs(const char *str, const char *const *subs,
+                         const char *const *replaces, int count);
 int mx_read_line(char **lineptr, size_t buf_size, char delim, const int fd);
 
 
@@ -72,6 +128,153 @@ void *mx_memmem(const void *big, size_t big_len, const void *little,
                 size_t little_len);
 void *mx_memmove(void *dst, const void *src, size_t len);
 void *mx_realloc(void *ptr, size_t size);
+void *mx_realloc_grow(void *ptr, size_t size);
+
+// Counted string pack
+// implementation in mx_str.c
+
+// Longest string kept inline without a heap allocation
+#define MX_STR_SMALL 23
+
+typedef struct  s_mx_str {
+    size_t len;
+    size_t cap;
+    union {
+        char *heap;
+        char small[MX_STR_SMALL + 1];
+    } u;
+}               t_mx_str;
+
+void mx_str_init(t_mx_str *s);
+int mx_str_from(t_mx_str *s, const char *cstr);
+int mx_str_from_len(t_mx_str *s, const char *data, size_t len);
+void mx_str_free(t_mx_str *s);
+char *mx_str_data(const t_mx_str *s);
+size_t mx_str_len(const t_mx_str *s);
+int mx_str_reserve(t_mx_str *s, size_t cap);
+int mx_str_cat(t_mx_str *s, const char *data, size_t len);
+int mx_str_cat_char(t_mx_str *s, char c);
+int mx_str_cat_cstr(t_mx_str *s, const char *cstr);
+int mx_str_cat_int(t_mx_str *s, int64_t n);
+int mx_str_cat_hex(t_mx_str *s, uint64_t n);
+int mx_str_dup(t_mx_str *dst, const t_mx_str *src);
+int mx_str_join(t_mx_str *dst, const t_mx_str *s1, const t_mx_str *s2);
+int mx_str_trim(t_mx_str *dst, const t_mx_str *src);
+t_mx_str *mx_str_split(const t_mx_str *src, char c, size_t *count);
+int mx_str_replace(t_mx_str *dst, const t_mx_str *src, const t_mx_str *sub,
+                   const t_mx_str *replace);
+char *mx_str_release(t_mx_str *s);
+int mx_replace_substr_str(t_mx_str *dst, const char *str, const char *sub,
+                          const char *replace);
+int mx_strtrim_str(t_mx_str *dst, const char *str);
+int mx_del_extra_spaces_str(t_mx_str *dst, const char *str);
+
+// Whitespace pack
+// implementation in mx_space.c
+
+typedef struct  s_mx_space_norm {
+    bool gap;                      // whitespace read since the last word
+    bool words;                    // a word has been written
+}               t_mx_space_norm;
+
+bool mx_isspace(char c);
+size_t mx_space_span(const char *s, size_t len);
+size_t mx_word_span(const char *s, size_t len);
+size_t mx_strtrim_inplace(char *s, size_t len);
+size_t mx_del_extra_spaces_inplace(char *s, size_t len);
+void mx_space_norm_init(t_mx_space_norm *st);
+// out must hold len + 1 bytes for a space pending from the last chunk
+size_t mx_space_norm(t_mx_space_norm *st, const char *in, size_t len,
+                     char *out);
+
+// Search pack
+// implementation in mx_search.c
+
+// Needles up to this length use the first/last byte filter, longer ones
+// use Boyer-Moore-Horspool
+#define MX_NEEDLE_SHORT 32
+
+typedef struct  s_mx_needle {
+    const unsigned char *bytes;
+    size_t len;
+    size_t shift[256];
+}               t_mx_needle;
+
+void mx_needle_init(t_mx_needle *needle, const void *bytes, size_t len);
+t_mx_needle *mx_needle_new(const void *bytes, size_t len);
+void mx_needle_del(t_mx_needle **needle);
+void *mx_needle_find(const t_mx_needle *needle, const void *hay,
+                     size_t hay_len);
+char *mx_replace_needle(const char *str, const t_mx_needle *needle,
+                        const char *replace);
+
+// Split pack
+// implementation in mx_split.c
+
+// Keep empty fields between adjacent delimiters
+#define MX_SPLIT_KEEP_EMPTY 1
+// Character sets up to this size are scanned with vector compares
+#define MX_SPLIT_SET_FAST 8
+
+typedef struct  s_mx_slice {
+    size_t offset;
+    size_t len;
+}               t_mx_slice;
+
+typedef struct  s_mx_split_iter {
+    const char *s;
+    size_t len;
+    size_t pos;
+    int mode;
+    int flags;
+    bool done;
+    size_t set_len;
+    char set_chars[MX_SPLIT_SET_FAST];
+    bool in_set[256];
+    t_mx_needle needle;
+}               t_mx_split_iter;
+
+void mx_split_init(t_mx_split_iter *it, const char *s, size_t len, char c,
+                   int flags);
+void mx_split_init_seq(t_mx_split_iter *it, const char *s, size_t len,
+                       const char *delim, int flags);
+void mx_split_init_set(t_mx_split_iter *it, const char *s, size_t len,
+                       const char *chars, int flags);
+bool mx_split_next(t_mx_split_iter *it, t_mx_slice *slice);
+size_t mx_split_fill(t_mx_split_iter *it, t_mx_slice *out, size_t max);
+size_t mx_split_slices(const char *s, char c, t_mx_slice *out, size_t max);
+
+// File pack
+// implementation in mx_file.c
+
+typedef struct  s_mx_view {
+    const char *data;
+    size_t len;
+    bool mapped;
+}               t_mx_view;
+
+char *mx_fd_to_str(int fd, size_t *len);
+int mx_file_view(const char *file, t_mx_view *view);
+void mx_view_release(t_mx_view *view);
+
+typedef struct  s_mx_reader {
+    int fd;
+    char *buf;
+    size_t cap;
+    size_t start;
+    size_t end;
+    bool eof;
+    bool crlf;
+    char delim;
+    size_t n_delims;
+    bool is_delim[256];
+}               t_mx_reader;
+
+t_mx_reader *mx_reader_new(int fd, size_t buf_size);
+void mx_reader_del(t_mx_reader **reader);
+void mx_reader_delims(t_mx_reader *reader, const char *delims, size_t count,
+                      bool crlf);
+ssize_t mx_reader_line(t_mx_reader *reader, char **line);
 
 // List pack
 // implementation in mx_list.c
@@ -87,4 +290,321 @@ void mx_push_back(t_list **list, void *data);
 void mx_pop_front(t_list **head);
 void mx_pop_back(t_list **head);
 int mx_list_size(t_list *list);
+// Stable; cmp(a, b) is true when a must go after b
 t_list *mx_sort_list(t_list *lst, bool (*cmp)(void *, void *));
+
+// Nodes per slab when a pool is created with slab_nodes == 0
+#define MX_NODE_POOL_SLAB 256
+
+typedef struct  s_mx_node_slab {
+    struct s_mx_node_slab *next;
+    size_t count;
+    size_t used;
+    t_list nodes[];
+}               t_mx_node_slab;
+
+typedef struct  s_mx_node_pool {
+    t_mx_node_slab *slabs;
+    t_list *free_list;
+    size_t slab_nodes;
+}               t_mx_node_pool;
+
+t_mx_node_pool *mx_node_pool_new(size_t slab_nodes);
+void mx_node_pool_put(t_mx_node_pool *pool, t_list *node);
+void mx_node_pool_reset(t_mx_node_pool *pool);
+void mx_node_pool_del(t_mx_node_pool **pool);
+t_list *mx_create_node_pool(t_mx_node_pool *pool, void *data);
+void mx_push_front_pool(t_mx_node_pool *pool, t_list **list, void *data);
+void mx_push_back_pool(t_mx_node_pool *pool, t_list **list, void *data);
+void mx_pop_front_pool(t_mx_node_pool *pool, t_list **head);
+void mx_pop_back_pool(t_mx_node_pool *pool, t_list **head);
+
+typedef struct  s_mx_list {
+    t_list *head;
+    t_list *tail;
+    size_t size;
+    t_mx_node_pool *pool;
+}               t_mx_list;
+
+void mx_list_init(t_mx_list *list);
+void mx_list_init_pool(t_mx_list *list, t_mx_node_pool *pool);
+int mx_list_push_front(t_mx_list *list, void *data);
+int mx_list_push_back(t_mx_list *list, void *data);
+void *mx_list_pop_front(t_mx_list *list);
+void mx_list_concat(t_mx_list *dst, t_mx_list *src);
+void mx_list_clear(t_mx_list *list);
+
+typedef struct  s_mx_dnode {
+    void *data;
+    struct s_mx_dnode *next;
+    struct s_mx_dnode *prev;
+}               t_mx_dnode;
+
+typedef struct  s_mx_dlist {
+    t_mx_dnode *head;
+    t_mx_dnode *tail;
+    size_t size;
+}               t_mx_dlist;
+
+void mx_dlist_init(t_mx_dlist *list);
+t_mx_dnode *mx_dlist_push_front(t_mx_dlist *list, void *data);
+t_mx_dnode *mx_dlist_push_back(t_mx_dlist *list, void *data);
+void *mx_dlist_remove(t_mx_dlist *list, t_mx_dnode *node);
+void *mx_dlist_pop_front(t_mx_dlist *list);
+void *mx_dlist_pop_back(t_mx_dlist *list);
+void mx_dlist_splice(t_mx_dlist *dst, t_mx_dnode *pos, t_mx_dlist *src);
+void mx_dlist_concat(t_mx_dlist *dst, t_mx_dlist *src);
+void mx_dlist_clear(t_mx_dlist *list);
+
+// Unrolled list pack
+// implementation in mx_ulist.c
+
+// Chunk size, a multiple of the cache line
+#define MX_ULIST_CHUNK_BYTES 256
+#define MX_ULIST_ITEMS ((MX_ULIST_CHUNK_BYTES - 2 * sizeof(void *) \
+                         - 2 * sizeof(unsigned int)) / sizeof(void *))
+
+typedef struct  s_mx_uchunk {
+    struct s_mx_uchunk *next;
+    struct s_mx_uchunk *prev;
+    unsigned int start;
+    unsigned int count;
+    void *items[MX_ULIST_ITEMS];
+}               t_mx_uchunk;
+
+typedef struct  s_mx_ulist {
+    t_mx_uchunk *head;
+    t_mx_uchunk *tail;
+    size_t size;
+}               t_mx_ulist;
+
+typedef struct  s_mx_uiter {
+    t_mx_uchunk *chunk;
+    unsigned int idx;
+}               t_mx_uiter;
+
+void mx_ulist_init(t_mx_ulist *list);
+int mx_ulist_push_back(t_mx_ulist *list, void *data);
+int mx_ulist_push_front(t_mx_ulist *list, void *data);
+void *mx_ulist_pop_back(t_mx_ulist *list);
+void *mx_ulist_pop_front(t_mx_ulist *list);
+void mx_ulist_iter(const t_mx_ulist *list, t_mx_uiter *it);
+bool mx_ulist_next(t_mx_uiter *it, void **data);
+void *mx_ulist_find(const t_mx_ulist *list, const void *key,
+                    int (*cmp)(const void *, const void *));
+int mx_ulist_sort(t_mx_ulist *list, int (*cmp)(const void *, const void *));
+int mx_ulist_from_list(t_mx_ulist *list, t_list *lst);
+t_list *mx_ulist_to_list(const t_mx_ulist *list);
+void mx_ulist_clear(t_mx_ulist *list);
+
+// Queue pack
+// implementation in mx_queue.c
+
+typedef struct  s_mx_ring_cell {
+    atomic_size_t seq;
+    void *data;
+}               t_mx_ring_cell;
+
+// Bounded lock-free MPMC queue
+typedef struct  s_mx_ring {
+    t_mx_ring_cell *cells;
+    size_t mask;
+    _Alignas(64) atomic_size_t head;
+    _Alignas(64) atomic_size_t tail;
+}               t_mx_ring;
+
+typedef struct  s_mx_qnode {
+    _Atomic(struct s_mx_qnode *) next;
+    void *data;
+    struct s_mx_qnode *overflow; // retired nodes that found no room
+}               t_mx_qnode;
+
+// Unbounded lock-free MPMC queue
+typedef struct  s_mx_queue {
+    _Alignas(64) _Atomic(t_mx_qnode *) head;
+    _Alignas(64) _Atomic(t_mx_qnode *) tail;
+}               t_mx_queue;
+
+t_mx_ring *mx_ring_new(size_t capacity);
+bool mx_ring_push(t_mx_ring *ring, void *data);
+bool mx_ring_pop(t_mx_ring *ring, void **data);
+void mx_ring_del(t_mx_ring **ring);
+t_mx_queue *mx_queue_new(void);
+int mx_queue_push(t_mx_queue *queue, void *data);
+bool mx_queue_pop(t_mx_queue *queue, void **data);
+void mx_queue_del(t_mx_queue **queue);
+
+// Sort pack
+// implementation in mx_sort.c
+
+void mx_sort(void *base, size_t n, size_t size,
+             int (*cmp)(const void *, const void *));
+long mx_stable_sort(void *base, size_t n, size_t size,
+                    int (*cmp)(const void *, const void *));
+long mx_stable_sort_ptrs(void **arr, size_t n, bool (*cmp)(void *, void *));
+void mx_sort_strarr(char **arr, size_t n);
+t_list *mx_list_merge_sort(t_list *lst, bool (*cmp)(void *, void *));
+
+// Binary search pack
+// implementation in mx_bsearch.c
+
+// Sorted string array with cached 8-byte key prefixes
+typedef struct  s_mx_strindex {
+    uint64_t *keys;
+    char **strs;
+    size_t *pos;  // sorted position of each Eytzinger slot, else NULL
+    size_t n;
+    bool eytzinger;
+}               t_mx_strindex;
+
+size_t mx_lower_bound(const void *base, size_t n, size_t size,
+                      const void *key, int (*cmp)(const void *, const void *));
+t_mx_strindex *mx_strindex_new(char **arr, size_t n, bool eytzinger);
+size_t mx_strindex_lower_bound(const t_mx_strindex *index, const char *s);
+long mx_strindex_find(const t_mx_strindex *index, const char *s);
+void mx_strindex_find_batch(const t_mx_strindex *index,
+                            const char *const *keys, size_t count, long *out);
+void mx_strindex_del(t_mx_strindex **index);
+
+// Arena pack
+// implementation in mx_arena.c
+
+typedef struct  s_mx_arena_block {
+    struct s_mx_arena_block *next;
+    size_t size;
+    size_t used;
+}               t_mx_arena_block;
+
+typedef struct  s_mx_arena {
+    t_mx_arena_block *head;
+    t_mx_arena_block *current;
+    size_t block_size;
+}               t_mx_arena;
+
+t_mx_arena *mx_arena_new(size_t block_size);
+void *mx_arena_alloc(t_mx_arena *arena, size_t size);
+char *mx_arena_strndup(t_mx_arena *arena, const char *s, size_t n);
+void mx_arena_reset(t_mx_arena *arena);
+void mx_arena_del(t_mx_arena **arena);
+char *mx_strnew_arena(t_mx_arena *arena, const int size);
+char *mx_itoa_arena(t_mx_arena *arena, int number);
+char *mx_nbr_to_hex_arena(t_mx_arena *arena, unsigned long nbr);
+char **mx_strsplit_arena(t_mx_arena *arena, const char *s, char c);
+t_list *mx_create_node_arena(t_mx_arena *arena, void *data);
+
+// Map pack
+// implementation in mx_map.c
+
+typedef struct  s_mx_map_slot {
+    const char *key;
+    void *value;
+    size_t len;
+    uint32_t hash;
+    uint32_t dist; // probe distance + 1, 0 for an empty slot
+}               t_mx_map_slot;
+
+typedef struct  s_mx_map_table {
+    t_mx_map_slot *slots;
+    size_t cap;
+    size_t count;
+}               t_mx_map_table;
+
+typedef struct  s_mx_map {
+    t_mx_map_table cur;
+    t_mx_map_table old; // being migrated into cur, slots NULL when not
+    size_t migrate_pos;
+    size_t size;
+    t_mx_arena *arena;
+}               t_mx_map;
+
+typedef struct  s_mx_map_iter {
+    const t_mx_map *map;
+    int table;
+    size_t idx;
+}               t_mx_map_iter;
+
+t_mx_map *mx_map_new(t_mx_arena *arena);
+int mx_map_set(t_mx_map *map, const char *key, void *value);
+void *mx_map_get(const t_mx_map *map, const char *key);
+bool mx_map_has(const t_mx_map *map, const char *key);
+bool mx_map_remove(t_mx_map *map, const char *key);
+void mx_map_iter(const t_mx_map *map, t_mx_map_iter *it);
+bool mx_map_next(t_mx_map_iter *it, const char **key, void **value);
+void mx_map_del(t_mx_map **map);
+
+// Stats pack
+// implementation in mx_stats.c
+
+/*
+ * Probes are compiled in only when libmx is built with -DMX_INSTRUMENT
+ * (make INSTRUMENT=1). Without it MX_PROBE and friends expand to nothing
+ * or to the plain libc call, and mx_stats_snapshot reports no functions.
+ */
+
+// Live counters of one instrumented function, one static per function
+typedef struct  s_mx_stat_site {
+    const char *name;
+    struct s_mx_stat_site *next;
+    atomic_bool linked;
+    atomic_uint_least64_t calls;
+    atomic_uint_least64_t bytes;
+    atomic_uint_least64_t cycles;
+    atomic_uint_least64_t allocs;
+    atomic_uint_least64_t frees;
+    atomic_uint_least64_t alloc_bytes;
+    atomic_uint_least64_t free_bytes;
+}               t_mx_stat_site;
+
+typedef struct  s_mx_probe {
+    t_mx_stat_site *site;
+    t_mx_stat_site *outer;
+    uint64_t start;
+}               t_mx_probe;
+
+// Copy of one function's counters; cycles include nested libmx calls
+typedef struct  s_mx_stat {
+    const char *name;
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t cycles;
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t alloc_bytes;
+    uint64_t free_bytes;
+}               t_mx_stat;
+
+// Heap use through libmx, measured in malloc_usable_size bytes
+typedef struct  s_mx_alloc_stats {
+    uint64_t allocs;
+    uint64_t frees;
+    int64_t live_bytes;
+    int64_t peak_bytes;
+}               t_mx_alloc_stats;
+
+bool mx_stats_enabled(void);
+size_t mx_stats_snapshot(t_mx_stat *funcs, size_t max,
+                         t_mx_alloc_stats *alloc);
+void mx_stats_reset(void);
+t_mx_probe mx_probe_begin(t_mx_stat_site *site);
+void mx_probe_end(t_mx_probe *probe);
+void *mx_stat_malloc(size_t size);
+void *mx_stat_aligned_alloc(size_t align, size_t size);
+void mx_stat_free(void *ptr);
+
+#ifdef MX_INSTRUMENT
+#define MX_PROBE() \
+    static t_mx_stat_site mx_site_ = {.name = __func__}; \
+    t_mx_probe mx_probe_ __attribute__((cleanup(mx_probe_end))) \
+        = mx_probe_begin(&mx_site_)
+#define MX_PROBE_BYTES(n) \
+    atomic_fetch_add_explicit(&mx_site_.bytes, (n), memory_order_relaxed)
+#define MX_MALLOC(size) mx_stat_malloc(size)
+#define MX_ALIGNED_ALLOC(align, size) mx_stat_aligned_alloc(align, size)
+#define MX_FREE(ptr) mx_stat_free(ptr)
+#else
+#define MX_PROBE() ((void)0)
+#define MX_PROBE_BYTES(n) ((void)sizeof(n))
+#define MX_MALLOC(size) malloc(size)
+#define MX_ALIGNED_ALLOC(align, size) aligned_alloc(align, size)
+#define MX_FREE(ptr) free(ptr)
+#endif
@@ -0,0 +1,223 @@
+/**
+ * @file mx_arena.c
+ * @brief Region (bump) allocator and arena-backed variants of allocating
+ *        libmx functions.
+ *
+ * An arena hands out memory by bumping an offset inside large blocks and
+ * frees everything at once with mx_arena_reset or mx_arena_del, so
+ * per-request parsing needs no individual frees and its data ends up
+ * packed together. Blocks are kept across resets and reused.
+ *
+ * Memory from an arena must never be passed to free, mx_strdel,
+ * mx_del_strarr, mx_pop_front or mx_pop_back.
+ *
+ * Functions:
+ * - t_mx_arena *mx_arena_new(size_t block_size): Creates an arena.
+ * - void *mx_arena_alloc(t_mx_arena *arena, size_t size): Allocates size bytes, suitably aligned for any type.
+ * - char *mx_arena_strndup(t_mx_arena *arena, const char *s, size_t n): Copies up to n bytes of s into the arena.
+ * - void mx_arena_reset(t_mx_arena *arena): Frees every allocation, keeping the blocks.
+ * - void mx_arena_del(t_mx_arena **arena): Frees the arena and sets the pointer to NULL.
+ * - char *mx_strnew_arena(t_mx_arena *arena, const int size): mx_strnew in an arena.
+ * - char *mx_itoa_arena(t_mx_arena *arena, int number): mx_itoa in an arena.
+ * - char *mx_nbr_to_hex_arena(t_mx_arena *arena, unsigned long nbr): mx_nbr_to_hex in an arena.
+ * - char **mx_strsplit_arena(t_mx_arena *arena, const char *s, char c): mx_strsplit in an arena.
+ * - t_list *mx_create_node_arena(t_mx_arena *arena, void *data): mx_create_node in an arena.
+ */
+
+#include "../inc/libmx.h"
+
+#define MX_ARENA_ALIGN _Alignof(max_align_t)
+#define MX_ARENA_DEFAULT_BLOCK 65536
+
+// One alignment step of slack guarantees that size bytes always fit
+static t_mx_arena_block *block_new(size_t size) {
+    size_t data = size + MX_ARENA_ALIGN - 1;
+    t_mx_arena_block *block = (t_mx_arena_block *)MX_MALLOC(
+        sizeof(t_mx_arena_block) + data);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = data;
+    block->used = 0;
+    return block;
+}
+
+static void *block_take(t_mx_arena_block *block, size_t size) {
+    uintptr_t base = (uintptr_t)(block + 1);
+    uintptr_t at = (base + block->used + MX_ARENA_ALIGN - 1)
+                   & ~(uintptr_t)(MX_ARENA_ALIGN - 1);
+
+    if (at - base > block->size || size > block->size - (at - base)) {
+        return NULL;
+    }
+    block->used = at - base + size;
+    return (void *)at;
+}
+
+t_mx_arena *mx_arena_new(size_t block_size) {
+    MX_PROBE();
+    t_mx_arena *arena = (t_mx_arena *)MX_MALLOC(sizeof(t_mx_arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    arena->block_size = block_size ? block_size : MX_ARENA_DEFAULT_BLOCK;
+    arena->head = NULL;
+    arena->current = NULL;
+    return arena;
+}
+
+/*
+ * Bumps inside the current block. When it is full the next kept block
+ * is tried, and only then is a fresh block linked in after the current
+ * one. Requests bigger than the block size get a block of their own.
+ */
+void *mx_arena_alloc(t_mx_arena *arena, size_t size) {
+    MX_PROBE();
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    t_mx_arena_block *cur = arena->current;
+    if (cur != NULL) {
+        void *p = block_take(cur, size);
+        if (p != NULL) {
+            return p;
+        }
+        if (cur->next != NULL && (p = block_take(cur->next, size)) != NULL) {
+            arena->current = cur->next;
+            return p;
+        }
+    }
+
+    size_t block_size = size > arena->block_size ? size : arena->block_size;
+    // block_new's header and slack would wrap around, leaving a tiny block
+    if (block_size > SIZE_MAX - sizeof(t_mx_arena_block) - MX_ARENA_ALIGN) {
+        return NULL;
+    }
+    t_mx_arena_block *block = block_new(block_size);
+    if (block == NULL) {
+        return NULL;
+    }
+    if (cur == NULL) {
+        arena->head = block;
+    } else {
+        block->next = cur->next;
+        cur->next = block;
+    }
+    arena->current = block;
+    return block_take(block, size);
+}
+
+char *mx_arena_strndup(t_mx_arena *arena, const char *s, size_t n) {
+    if (s == NULL) {
+        return NULL;
+    }
+
+    size_t len = 0;
+    while (len < n && s[len]) len++;
+
+    char *res = (char *)mx_arena_alloc(arena, len + 1);
+    if (res == NULL) {
+        return NULL;
+    }
+    mx_memcpy(res, s, len);
+    res[len] = '\0';
+    return res;
+}
+
+void mx_arena_reset(t_mx_arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    for (t_mx_arena_block *b = arena->head; b != NULL; b = b->next) {
+        b->used = 0;
+    }
+    arena->current = arena->head;
+}
+
+void mx_arena_del(t_mx_arena **arena) {
+    MX_PROBE();
+    if (arena == NULL || *arena == NULL) {
+        return;
+    }
+
+    t_mx_arena_block *b = (*arena)->head;
+    while (b != NULL) {
+        t_mx_arena_block *next = b->next;
+        MX_FREE(b);
+        b = next;
+    }
+    MX_FREE(*arena);
+    *arena = NULL;
+}
+
+char *mx_strnew_arena(t_mx_arena *arena, const int size) {
+    if (size < 0) return NULL;
+    char *res = (char *)mx_arena_alloc(arena, size + 1);
+    if (res == NULL) return NULL;
+
+    mx_memset(res, '\0', size + 1);
+
+    return res;
+}
+
+char *mx_itoa_arena(t_mx_arena *arena, int number) {
+    char buf[MX_NBR_BUF];
+    size_t len = mx_i64_to_buf(number, buf);
+
+    return mx_arena_strndup(arena, buf, len);
+}
+
+char *mx_nbr_to_hex_arena(t_mx_arena *arena, unsigned long nbr) {
+    char buf[MX_NBR_BUF];
+    size_t len = mx_hex_to_buf(nbr, buf);
+
+    return mx_arena_strndup(arena, buf, len);
+}
+
+char **mx_strsplit_arena(t_mx_arena *arena, const char *s, char c) {
+    if (s == NULL) {
+        return NULL;
+    }
+
+    int word_count = mx_count_words(s, c);
+    char **result = (char **)mx_arena_alloc(arena,
+                                            (word_count + 1) * sizeof(char *));
+    if (result == NULL) {
+        return NULL;
+    }
+
+    int index = 0;
+    int i = 0;
+
+    while (index < word_count) {
+        while (s[i] == c) {
+            i++;
+        }
+        int start = i;
+        while (s[i] && s[i] != c) {
+            i++;
+        }
+        result[index] = mx_arena_strndup(arena, s + start, i - start);
+        if (result[index++] == NULL) {
+            return NULL;
+        }
+    }
+
+    result[index] = NULL;
+
+    return result;
+}
+
+t_list *mx_create_node_arena(t_mx_arena *arena, void *data) {
+    t_list *node = (t_list *)mx_arena_alloc(arena, sizeof(t_list));
+    if (node == NULL) {
+        return NULL;
+    }
+    node->data = data;
+    node->next = NULL;
+    return node;
+}
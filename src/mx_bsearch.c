@@ -0,0 +1,295 @@
+/**
+ * @file mx_bsearch.c
+ * @brief Branchless lower_bound and a prefix-cached string index with
+ *        batched lookups.
+ *
+ * The search loops below never branch on a comparison result: each
+ * step picks the next position with a conditional move, so there are no
+ * mispredictions, and the cache lines that might be needed next are
+ * prefetched while the current comparison waits on memory.
+ *
+ * t_mx_strindex keeps the first 8 bytes of every string packed
+ * big-endian into a uint64_t, so a probe is one integer comparison and
+ * a string is only read when the prefixes tie. Tables that are built
+ * once and searched often can use the Eytzinger (BFS) layout, where the
+ * nodes of the top levels share cache lines and the eight descendants
+ * of a node three levels down are 64 contiguous bytes of keys that are
+ * prefetched in one go. The batch lookup advances many keys one level
+ * at a time, so their cache misses overlap instead of queueing up.
+ *
+ * Strings are ordered as unsigned bytes, like strcmp and mx_sort_strarr.
+ *
+ * Functions:
+ * - size_t mx_lower_bound(const void *base, size_t n, size_t size, const void *key, int (*cmp)(const void *, const void *)): First element not less than key.
+ * - t_mx_strindex *mx_strindex_new(char **arr, size_t n, bool eytzinger): Indexes a sorted string array.
+ * - size_t mx_strindex_lower_bound(const t_mx_strindex *index, const char *s): Position in arr of the first string not less than s.
+ * - long mx_strindex_find(const t_mx_strindex *index, const char *s): Position of s in arr or -1.
+ * - void mx_strindex_find_batch(const t_mx_strindex *index, const char *const *keys, size_t count, long *out): mx_strindex_find for many keys at once.
+ * - void mx_strindex_del(t_mx_strindex **index): Frees the index and sets the pointer to NULL.
+ */
+
+#include "../inc/libmx.h"
+
+// Lookups advanced together by mx_strindex_find_batch
+#define MX_BSEARCH_BATCH 16
+
+size_t mx_lower_bound(const void *base, size_t n, size_t size,
+                      const void *key, int (*cmp)(const void *, const void *)) {
+    if (base == NULL || cmp == NULL || n == 0) {
+        return 0;
+    }
+
+    const char *b = (const char *)base;
+    while (n > 1) {
+        size_t half = n / 2;
+        __builtin_prefetch(b + (half / 2) * size);
+        __builtin_prefetch(b + (half + half / 2) * size);
+        b = cmp(b + half * size, key) < 0 ? b + half * size : b;
+        n -= half;
+    }
+    return (size_t)(b - (const char *)base) / size + (cmp(b, key) < 0);
+}
+
+// Packs the first 8 bytes big-endian, zero-padded after the '\0'
+static uint64_t prefix_key(const char *s) {
+    uint64_t key = 0;
+    int i = 0;
+
+    for (; i < 8 && s[i]; i++) {
+        key = (key << 8) | (unsigned char)s[i];
+    }
+    return i == 0 ? 0 : key << (8 * (8 - i));
+}
+
+static int cmp_tail(const char *a, const char *b) {
+    const unsigned char *s1 = (const unsigned char *)a + 8;
+    const unsigned char *s2 = (const unsigned char *)b + 8;
+    while (*s1 && *s1 == *s2) {
+        s1++;
+        s2++;
+    }
+    return *s1 - *s2;
+}
+
+/*
+ * Whether entry i sorts before s. Equal prefixes ending in a zero byte
+ * belong to strings that both ended inside them, so they are equal.
+ */
+static inline bool entry_less(const t_mx_strindex *index, size_t i,
+                              const char *s, uint64_t key) {
+    uint64_t k = index->keys[i];
+    if (k != key) {
+        return k < key;
+    }
+    return (key & 0xFF) != 0 && cmp_tail(index->strs[i], s) < 0;
+}
+
+static bool entry_equal(const t_mx_strindex *index, size_t i,
+                        const char *s, uint64_t key) {
+    return index->keys[i] == key
+           && ((key & 0xFF) == 0 || cmp_tail(index->strs[i], s) == 0);
+}
+
+// In-order walk of the implicit tree fills the BFS slots in sorted order
+static size_t eytzinger_fill(t_mx_strindex *index, char **arr,
+                             size_t i, size_t k) {
+    if (k <= index->n) {
+        i = eytzinger_fill(index, arr, i, 2 * k);
+        index->strs[k] = arr[i];
+        index->keys[k] = prefix_key(arr[i]);
+        index->pos[k] = i++;
+        i = eytzinger_fill(index, arr, i, 2 * k + 1);
+    }
+    return i;
+}
+
+t_mx_strindex *mx_strindex_new(char **arr, size_t n, bool eytzinger) {
+    MX_PROBE();
+    if (arr == NULL) {
+        return NULL;
+    }
+
+    t_mx_strindex *index = (t_mx_strindex *)MX_MALLOC(sizeof(t_mx_strindex));
+    if (index == NULL) {
+        return NULL;
+    }
+    // The Eytzinger layout is 1-based, slot 0 is unused
+    size_t slots = eytzinger ? n + 1 : n;
+    index->n = n;
+    index->eytzinger = eytzinger;
+    index->keys = (uint64_t *)MX_MALLOC((slots ? slots : 1) * sizeof(uint64_t));
+    index->strs = (char **)MX_MALLOC((slots ? slots : 1) * sizeof(char *));
+    index->pos = eytzinger ? (size_t *)MX_MALLOC(slots * sizeof(size_t)) : NULL;
+    if (index->keys == NULL || index->strs == NULL
+        || (eytzinger && index->pos == NULL)) {
+        mx_strindex_del(&index);
+        return NULL;
+    }
+
+    if (eytzinger) {
+        eytzinger_fill(index, arr, 0, 1);
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            index->strs[i] = arr[i];
+            index->keys[i] = prefix_key(arr[i]);
+        }
+    }
+    return index;
+}
+
+static size_t sorted_lower_bound(const t_mx_strindex *index, const char *s,
+                                 uint64_t key) {
+    size_t base = 0;
+    size_t n = index->n;
+
+    if (n == 0) {
+        return 0;
+    }
+    while (n > 1) {
+        size_t half = n / 2;
+        __builtin_prefetch(&index->keys[base + half / 2]);
+        __builtin_prefetch(&index->keys[base + half + half / 2]);
+        base = entry_less(index, base + half, s, key) ? base + half : base;
+        n -= half;
+    }
+    return base + entry_less(index, base, s, key);
+}
+
+/*
+ * Descends left on "not less" and right on "less". The answer is the
+ * last node where the walk turned left, recovered by dropping the
+ * trailing right turns (one bits) and that left turn from k. Returns
+ * its slot, 0 when every entry is less than s.
+ */
+static size_t eytzinger_slot(const t_mx_strindex *index, const char *s,
+                             uint64_t key) {
+    size_t k = 1;
+
+    while (k <= index->n) {
+        __builtin_prefetch(&index->keys[8 * k]);
+        k = 2 * k + entry_less(index, k, s, key);
+    }
+    return k >> (__builtin_ctzl(~k) + 1);
+}
+
+size_t mx_strindex_lower_bound(const t_mx_strindex *index, const char *s) {
+    if (index == NULL || s == NULL) {
+        return 0;
+    }
+
+    uint64_t key = prefix_key(s);
+    if (index->eytzinger) {
+        size_t k = eytzinger_slot(index, s, key);
+        return k == 0 ? index->n : index->pos[k];
+    }
+    return sorted_lower_bound(index, s, key);
+}
+
+long mx_strindex_find(const t_mx_strindex *index, const char *s) {
+    if (index == NULL || s == NULL) {
+        return -1;
+    }
+
+    uint64_t key = prefix_key(s);
+    if (index->eytzinger) {
+        size_t k = eytzinger_slot(index, s, key);
+        return k != 0 && entry_equal(index, k, s, key)
+               ? (long)index->pos[k] : -1;
+    }
+
+    size_t i = sorted_lower_bound(index, s, key);
+    return i < index->n && entry_equal(index, i, s, key) ? (long)i : -1;
+}
+
+static void batch_sorted(const t_mx_strindex *index, const char *const *keys,
+                         const uint64_t *prefix, size_t count, long *out) {
+    size_t base[MX_BSEARCH_BATCH] = {0};
+
+    // Every lookup shrinks the same n the same way, so they run in step
+    for (size_t n = index->n; n > 1; n -= n / 2) {
+        size_t half = n / 2;
+        for (size_t j = 0; j < count; j++) {
+            __builtin_prefetch(&index->keys[base[j] + half / 2]);
+            __builtin_prefetch(&index->keys[base[j] + half + half / 2]);
+        }
+        for (size_t j = 0; j < count; j++) {
+            base[j] = entry_less(index, base[j] + half, keys[j], prefix[j])
+                      ? base[j] + half : base[j];
+        }
+    }
+    for (size_t j = 0; j < count; j++) {
+        size_t i = base[j] + entry_less(index, base[j], keys[j], prefix[j]);
+        out[j] = i < index->n && entry_equal(index, i, keys[j], prefix[j])
+                 ? (long)i : -1;
+    }
+}
+
+static void batch_eytzinger(const t_mx_strindex *index,
+                            const char *const *keys, const uint64_t *prefix,
+                            size_t count, long *out) {
+    size_t k[MX_BSEARCH_BATCH];
+    bool running = true;
+
+    for (size_t j = 0; j < count; j++) {
+        k[j] = 1;
+    }
+    // Leaves differ in depth by at most one level
+    while (running) {
+        running = false;
+        for (size_t j = 0; j < count; j++) {
+            if (k[j] <= index->n) {
+                __builtin_prefetch(&index->keys[8 * k[j]]);
+                k[j] = 2 * k[j] + entry_less(index, k[j], keys[j], prefix[j]);
+                running |= k[j] <= index->n;
+            }
+        }
+    }
+    for (size_t j = 0; j < count; j++) {
+        size_t r = k[j] >> (__builtin_ctzl(~k[j]) + 1);
+        out[j] = r != 0 && entry_equal(index, r, keys[j], prefix[j])
+                 ? (long)index->pos[r] : -1;
+    }
+}
+
+void mx_strindex_find_batch(const t_mx_strindex *index,
+                            const char *const *keys, size_t count, long *out) {
+    if (index == NULL || keys == NULL || out == NULL) {
+        return;
+    }
+
+    uint64_t prefix[MX_BSEARCH_BATCH];
+    for (size_t done = 0; done < count; done += MX_BSEARCH_BATCH) {
+        size_t m = count - done < MX_BSEARCH_BATCH ? count - done
+                                                    : MX_BSEARCH_BATCH;
+        bool valid = true;
+        for (size_t j = 0; j < m; j++) {
+            valid &= keys[done + j] != NULL;
+        }
+        if (!valid || index->n == 0) {
+            for (size_t j = 0; j < m; j++) {
+                out[done + j] = mx_strindex_find(index, keys[done + j]);
+            }
+            continue;
+        }
+        for (size_t j = 0; j < m; j++) {
+            prefix[j] = prefix_key(keys[done + j]);
+        }
+        if (index->eytzinger) {
+            batch_eytzinger(index, keys + done, prefix, m, out + done);
+        } else {
+            batch_sorted(index, keys + done, prefix, m, out + done);
+        }
+    }
+}
+
+void mx_strindex_del(t_mx_strindex **index) {
+    MX_PROBE();
+    if (index == NULL || *index == NULL) {
+        return;
+    }
+    MX_FREE((*index)->keys);
+    MX_FREE((*index)->strs);
+    MX_FREE((*index)->pos);
+    MX_FREE(*index);
+    *index = NULL;
+}
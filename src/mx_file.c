@@ -0,0 +1,291 @@
+/**
+ * @file mx_file.c
+ * @brief Whole-file input: reading into a string and read-only mapped views.
+ *
+ * Sizes come from a single fstat instead of counting bytes, and reads
+ * loop until EOF so short reads and inputs without a known size (pipes,
+ * character devices, procfs) are handled. Regular files can also be
+ * mapped with mx_file_view so large inputs are never copied.
+ *
+ * A t_mx_reader belongs to its caller and reads ahead: bytes past the
+ * last returned line stay in its buffer, so a descriptor read through a
+ * reader should not also be read directly. mx_read_line keeps no state
+ * and reads nothing past the delimiter.
+ *
+ * Functions:
+ * - char *mx_fd_to_str(int fd, size_t *len): Reads everything left on fd into a new string.
+ * - int mx_file_view(const char *file, t_mx_view *view): Maps a file read-only.
+ * - void mx_view_release(t_mx_view *view): Releases a view from mx_file_view.
+ * - t_mx_reader *mx_reader_new(int fd, size_t buf_size): Creates a buffered line reader for fd.
+ * - void mx_reader_del(t_mx_reader **reader): Frees a reader and sets the pointer to NULL.
+ * - void mx_reader_delims(t_mx_reader *reader, const char *delims, size_t count, bool crlf): Sets the line delimiters.
+ * - ssize_t mx_reader_line(t_mx_reader *reader, char **line): Returns the next line from the reader.
+ */
+
+#include "../inc/libmx.h"
+
+// Read granularity for inputs whose size is not known up front
+#define MX_READ_CHUNK 65536
+
+char *mx_fd_to_str(int fd, size_t *len) {
+    MX_PROBE();
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    size_t cap = MX_READ_CHUNK;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        cap = (size_t)st.st_size;
+    }
+
+    char *buf = (char *)MX_MALLOC(cap + 1);
+    if (buf == NULL) {
+        return NULL;
+    }
+
+    size_t size = 0;
+    while (true) {
+        if (size == cap) {
+            // Probe into the spare byte first so an exact fstat size
+            // reaches EOF without growing the buffer
+            ssize_t got = read(fd, buf + size, 1);
+            if (got <= 0) {
+                if (got == 0) {
+                    break;
+                }
+                MX_FREE(buf);
+                return NULL;
+            }
+            size++;
+            char *grown = mx_realloc_grow(buf, size + MX_READ_CHUNK + 1);
+            if (grown == NULL) {
+                MX_FREE(buf);
+                return NULL;
+            }
+            buf = grown;
+            cap = malloc_usable_size(buf) - 1;
+        }
+        ssize_t got = read(fd, buf + size, cap - size);
+        if (got < 0) {
+            MX_FREE(buf);
+            return NULL;
+        }
+        if (got == 0) {
+            break;
+        }
+        size += (size_t)got;
+    }
+
+    buf[size] = '\0';
+    if (len != NULL) {
+        *len = size;
+    }
+    return buf;
+}
+
+/*
+ * Regular, non-empty files are mapped. Anything else is read into the
+ * heap, so callers get the same view either way and release it the same
+ * way.
+ */
+int mx_file_view(const char *file, t_mx_view *view) {
+    if (file == NULL || view == NULL) {
+        return -1;
+    }
+
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                         fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            return -1;
+        }
+        view->data = map;
+        view->len = (size_t)st.st_size;
+        view->mapped = true;
+        return 0;
+    }
+
+    char *data = mx_fd_to_str(fd, &view->len);
+    close(fd);
+    if (data == NULL) {
+        return -1;
+    }
+    view->data = data;
+    view->mapped = false;
+    return 0;
+}
+
+void mx_view_release(t_mx_view *view) {
+    MX_PROBE();
+    if (view == NULL || view->data == NULL) {
+        return;
+    }
+
+    if (view->mapped) {
+        munmap((void *)view->data, view->len);
+    } else {
+        MX_FREE((void *)view->data);
+    }
+    view->data = NULL;
+    view->len = 0;
+    view->mapped = false;
+}
+
+t_mx_reader *mx_reader_new(int fd, size_t buf_size) {
+    MX_PROBE();
+    if (fd < 0) {
+        return NULL;
+    }
+
+    t_mx_reader *reader = (t_mx_reader *)MX_MALLOC(sizeof(t_mx_reader));
+    if (reader == NULL) {
+        return NULL;
+    }
+
+    if (buf_size == 0) {
+        buf_size = MX_READ_CHUNK;
+    }
+    // One spare byte so a final line without a delimiter can be terminated
+    reader->buf = (char *)MX_MALLOC(buf_size + 1);
+    if (reader->buf == NULL) {
+        MX_FREE(reader);
+        return NULL;
+    }
+    reader->fd = fd;
+    reader->cap = buf_size;
+    reader->start = 0;
+    reader->end = 0;
+    reader->eof = false;
+    mx_reader_delims(reader, "\n", 1, false);
+    return reader;
+}
+
+void mx_reader_del(t_mx_reader **reader) {
+    MX_PROBE();
+    if (reader == NULL || *reader == NULL) {
+        return;
+    }
+
+    MX_FREE((*reader)->buf);
+    MX_FREE(*reader);
+    *reader = NULL;
+}
+
+void mx_reader_delims(t_mx_reader *reader, const char *delims, size_t count,
+                      bool crlf) {
+    if (reader == NULL || delims == NULL || count == 0) {
+        return;
+    }
+
+    mx_memset(reader->is_delim, 0, sizeof(reader->is_delim));
+    for (size_t i = 0; i < count; i++) {
+        reader->is_delim[(unsigned char)delims[i]] = true;
+    }
+    reader->delim = delims[0];
+    reader->n_delims = count;
+    reader->crlf = crlf;
+}
+
+static char *find_delim(const t_mx_reader *reader, char *p, size_t n) {
+    if (reader->n_delims == 1) {
+        return mx_memchr(p, reader->delim, n);
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (reader->is_delim[(unsigned char)p[i]]) {
+            return p + i;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Moves the unread tail to the front of the buffer, growing it when a
+ * single line fills it, then reads as much as fits.
+ */
+static int refill(t_mx_reader *reader) {
+    size_t pending = reader->end - reader->start;
+
+    if (reader->start > 0) {
+        mx_memmove(reader->buf, reader->buf + reader->start, pending);
+        reader->start = 0;
+        reader->end = pending;
+    }
+    if (reader->end == reader->cap) {
+        char *grown = mx_realloc_grow(reader->buf, reader->cap * 2 + 1);
+        if (grown == NULL) {
+            return -1;
+        }
+        reader->buf = grown;
+        reader->cap = malloc_usable_size(grown) - 1;
+    }
+
+    ssize_t got = read(reader->fd, reader->buf + reader->end,
+                       reader->cap - reader->end);
+    if (got < 0) {
+        return -1;
+    }
+    if (got == 0) {
+        reader->eof = true;
+    }
+    reader->end += (size_t)got;
+    return 0;
+}
+
+/*
+ * Returns the length of the next line, not counting its delimiter, and
+ * points *line at it inside the reader's buffer with the delimiter
+ * replaced by '\0'. The line stays valid until the next call. Returns -1
+ * at end of input and -2 on a read or allocation error.
+ */
+ssize_t mx_reader_line(t_mx_reader *reader, char **line) {
+    MX_PROBE();
+    if (reader == NULL || line == NULL) {
+        return -2;
+    }
+
+    size_t scanned = 0;
+    while (true) {
+        char *p = reader->buf + reader->start;
+        size_t avail = reader->end - reader->start;
+        char *hit = find_delim(reader, p + scanned, avail - scanned);
+
+        if (hit != NULL) {
+            size_t len = hit - p;
+            bool newline = *hit == '\n';
+            *hit = '\0';
+            reader->start += len + 1;
+            if (reader->crlf && newline && len > 0 && p[len - 1] == '\r') {
+                p[--len] = '\0';
+            }
+            *line = p;
+            return len;
+        }
+        if (reader->eof) {
+            if (avail == 0) {
+                return -1;
+            }
+            p[avail] = '\0';
+            reader->start = reader->end;
+            *line = p;
+            return avail;
+        }
+
+        scanned = avail;
+        if (refill(reader) < 0) {
+            return -2;
+        }
+    }
+}
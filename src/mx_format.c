@@ -0,0 +1,189 @@
+/**
+ * @file mx_format.c
+ * @brief Integer formatting into caller-provided buffers and hex parsing.
+ *
+ * Nothing here allocates. Decimal output knows its length up front from
+ * a clz-based log10 estimate, then writes two digits per step from a
+ * 200-byte pair table, so there is one division by a constant (compiled
+ * to a multiply) per two digits. Power-of-two bases are written with
+ * shifts and masks. Every function NUL-terminates and returns the length
+ * written, not counting the '\0'.
+ *
+ * Functions:
+ * - size_t mx_u64_to_buf(uint64_t n, char *buf): Writes n in decimal, buf holds MX_NBR_BUF.
+ * - size_t mx_i64_to_buf(int64_t n, char *buf): Writes n in decimal with a sign, buf holds MX_NBR_BUF.
+ * - size_t mx_hex_to_buf(uint64_t n, char *buf): Writes n in lowercase hex, buf holds MX_NBR_BUF.
+ * - size_t mx_base_to_buf(uint64_t n, unsigned int base, char *buf): Writes n in base 2..36, buf holds MX_BASE_BUF.
+ * - int mx_parse_hex(const char *s, uint64_t *nbr, const char **end): Parses leading hex digits, reporting overflow.
+ */
+
+#include "../inc/libmx.h"
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+static const uint64_t pow10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL
+};
+
+/*
+ * 1233 / 4096 approximates log10(2), so bits * 1233 >> 12 is the number
+ * of digits of 2^(bits - 1) minus one; one comparison fixes it up. n | 1
+ * makes 0 count as one digit and changes nothing else, as every other
+ * power of ten is even.
+ */
+static size_t count_digits(uint64_t n) {
+    n |= 1;
+    size_t t = ((64 - __builtin_clzll(n)) * 1233) >> 12;
+    return t + 1 - (n < pow10[t]);
+}
+
+size_t mx_u64_to_buf(uint64_t n, char *buf) {
+    if (buf == NULL) {
+        return 0;
+    }
+
+    size_t len = count_digits(n);
+    char *p = buf + len;
+
+    *p = '\0';
+    while (n >= 100) {
+        size_t pair = (n % 100) * 2;
+        n /= 100;
+        p -= 2;
+        p[0] = digit_pairs[pair];
+        p[1] = digit_pairs[pair + 1];
+    }
+    if (n >= 10) {
+        p[-2] = digit_pairs[n * 2];
+        p[-1] = digit_pairs[n * 2 + 1];
+    } else {
+        p[-1] = (char)('0' + n);
+    }
+    return len;
+}
+
+size_t mx_i64_to_buf(int64_t n, char *buf) {
+    if (buf == NULL) {
+        return 0;
+    }
+    if (n >= 0) {
+        return mx_u64_to_buf((uint64_t)n, buf);
+    }
+
+    *buf = '-';
+    return 1 + mx_u64_to_buf(0 - (uint64_t)n, buf + 1);
+}
+
+// Bases 2, 4, 8, 16 and 32: shift bits per digit
+static size_t pow2_to_buf(uint64_t n, int shift, char *buf) {
+    size_t bits = 64 - __builtin_clzll(n | 1);
+    size_t len = (bits + shift - 1) / shift;
+    uint64_t mask = ((uint64_t)1 << shift) - 1;
+
+    buf[len] = '\0';
+    for (size_t i = len; i > 0; i--) {
+        buf[i - 1] = digits[n & mask];
+        n >>= shift;
+    }
+    return len;
+}
+
+size_t mx_hex_to_buf(uint64_t n, char *buf) {
+    if (buf == NULL) {
+        return 0;
+    }
+
+    return pow2_to_buf(n, 4, buf);
+}
+
+size_t mx_base_to_buf(uint64_t n, unsigned int base, char *buf) {
+    if (buf == NULL || base < 2 || base > 36) {
+        return 0;
+    }
+    if (base == 10) {
+        return mx_u64_to_buf(n, buf);
+    }
+    if ((base & (base - 1)) == 0) {
+        return pow2_to_buf(n, __builtin_ctz(base), buf);
+    }
+
+    char tmp[MX_BASE_BUF];
+    size_t i = sizeof(tmp);
+    do {
+        tmp[--i] = digits[n % base];
+        n /= base;
+    } while (n > 0);
+
+    size_t len = sizeof(tmp) - i;
+    mx_memcpy(buf, tmp + i, len);
+    buf[len] = '\0';
+    return len;
+}
+
+static int hex_value(unsigned char c) {
+    if ((unsigned)(c - '0') < 10) {
+        return c - '0';
+    }
+    c |= 0x20;
+    if ((unsigned)(c - 'a') < 6) {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/*
+ * Reads hex digits up to the first other character and stores the end
+ * there. Returns 0 on success, -1 when there is no digit at all and -2
+ * when the value does not fit, in which case nbr is UINT64_MAX and end
+ * still points past the last digit.
+ */
+int mx_parse_hex(const char *s, uint64_t *nbr, const char **end) {
+    if (s == NULL) {
+        return -1;
+    }
+
+    const char *p = s;
+    uint64_t value = 0;
+    bool overflow = false;
+    int d;
+
+    // Leading zeros never overflow
+    while (*p == '0') p++;
+    const char *first = p;
+    while ((d = hex_value((unsigned char)*p)) >= 0) {
+        value = (value << 4) | (uint64_t)d;
+        p++;
+    }
+    if (p - first > 16) {
+        overflow = true;
+        value = UINT64_MAX;
+    }
+
+    if (nbr != NULL) {
+        *nbr = value;
+    }
+    if (end != NULL) {
+        *end = p;
+    }
+    if (p == s) {
+        return -1;
+    }
+    return overflow ? -2 : 0;
+}
@@ -1,7 +1,8 @@
 #include "../inc/libmx.h"
 
 t_list *mx_create_node(void *data) {
-    t_list *node = (t_list *)malloc(sizeof(t_list));
+    MX_PROBE();
+    t_list *node = (t_list *)MX_MALLOC(sizeof(t_list));
     if (node == NULL) {
         return NULL;
     }
@@ -11,6 +12,7 @@ t_list *mx_create_node(void *data) {
 }
 
 void mx_push_front(t_list **list, void *data) {
+    MX_PROBE();
     t_list *node = mx_create_node(data);
     if (node == NULL) {
         return;
@@ -20,6 +22,7 @@ void mx_push_front(t_list **list, void *data) {
 }
 
 void mx_push_back(t_list **list, void *data) {
+    MX_PROBE();
     t_list *node = mx_create_node(data);
     if (node == NULL) {
         return;
@@ -36,20 +39,22 @@ void mx_push_back(t_list **list, void *data) {
 }
 
 void mx_pop_front(t_list **head) {
+    MX_PROBE();
     if (*head == NULL) {
         return;
     }
     t_list *temp = (*head)->next;
-    free(*head);
+    MX_FREE(*head);
     *head = temp;
 }
 
 void mx_pop_back(t_list **head) {
+    MX_PROBE();
     if (*head == NULL) {
         return;
     }
     if ((*head)->next == NULL) {
-        free(*head);
+        MX_FREE(*head);
         *head = NULL;
         return;
     }
@@ -57,11 +62,12 @@ void mx_pop_back(t_list **head) {
     while (last->next->next != NULL) {
         last = last->next;
     }
-    free(last->next);
+    MX_FREE(last->next);
     last->next = NULL;
 }
 
 int mx_list_size(t_list *list) {
+    MX_PROBE();
     int size = 0;
     for (t_list *node = list; node != NULL; node = node->next) {
         size++;
@@ -69,18 +75,461 @@ int mx_list_size(t_list *list) {
     return size;
 }
 
+/*
+ * Stable: data that compare equal keep their relative order. The data
+ * pointers are sorted as an array so the nodes keep their places; if
+ * the array cannot be allocated, adjacent swaps sort them in place.
+ */
 t_list *mx_sort_list(t_list *lst, bool (*cmp)(void *, void *)) {
+    MX_PROBE();
     if (lst == NULL) {
         return NULL;
     }
-    for (t_list *i = lst; i != NULL; i = i->next) {
-        for (t_list *j = i->next; j != NULL; j = j->next) {
-            if (cmp(i->data, j->data)) {
+    size_t n = mx_list_size(lst);
+    void **data = (void **)MX_MALLOC(n * sizeof(void *));
+    if (data != NULL) {
+        size_t k = 0;
+        for (t_list *i = lst; i != NULL; i = i->next) {
+            data[k++] = i->data;
+        }
+        mx_stable_sort_ptrs(data, n, cmp);
+        k = 0;
+        for (t_list *i = lst; i != NULL; i = i->next) {
+            i->data = data[k++];
+        }
+        MX_FREE(data);
+        return lst;
+    }
+    for (bool swapped = true; swapped;) {
+        swapped = false;
+        for (t_list *i = lst; i->next != NULL; i = i->next) {
+            if (cmp(i->data, i->next->data)) {
                 void *temp = i->data;
-                i->data = j->data;
-                j->data = temp;
+                i->data = i->next->data;
+                i->next->data = temp;
+                swapped = true;
             }
         }
     }
     return lst;
 }
+
+/*
+ * t_mx_list: a header over a plain t_list chain that also tracks the tail
+ * and the size. The chain itself stays a valid t_list, so every function
+ * above can still be used on list->head for read-only work.
+ */
+void mx_list_init(t_mx_list *list) {
+    MX_PROBE();
+    if (list == NULL) {
+        return;
+    }
+    list->head = NULL;
+    list->tail = NULL;
+    list->size = 0;
+    list->pool = NULL;
+}
+
+// Like mx_list_init, but nodes come from and go back to pool
+void mx_list_init_pool(t_mx_list *list, t_mx_node_pool *pool) {
+    MX_PROBE();
+    mx_list_init(list);
+    if (list != NULL) {
+        list->pool = pool;
+    }
+}
+
+static t_list *list_node(t_mx_list *list, void *data) {
+    return list->pool ? mx_create_node_pool(list->pool, data)
+                      : mx_create_node(data);
+}
+
+static void list_release(t_mx_list *list, t_list *node) {
+    if (list->pool) {
+        mx_node_pool_put(list->pool, node);
+    } else {
+        MX_FREE(node);
+    }
+}
+
+int mx_list_push_front(t_mx_list *list, void *data) {
+    MX_PROBE();
+    if (list == NULL) {
+        return -1;
+    }
+    t_list *node = list_node(list, data);
+    if (node == NULL) {
+        return -1;
+    }
+    node->next = list->head;
+    list->head = node;
+    if (list->tail == NULL) {
+        list->tail = node;
+    }
+    list->size++;
+    return 0;
+}
+
+int mx_list_push_back(t_mx_list *list, void *data) {
+    MX_PROBE();
+    if (list == NULL) {
+        return -1;
+    }
+    t_list *node = list_node(list, data);
+    if (node == NULL) {
+        return -1;
+    }
+    if (list->tail == NULL) {
+        list->head = node;
+    } else {
+        list->tail->next = node;
+    }
+    list->tail = node;
+    list->size++;
+    return 0;
+}
+
+void *mx_list_pop_front(t_mx_list *list) {
+    MX_PROBE();
+    if (list == NULL || list->head == NULL) {
+        return NULL;
+    }
+    t_list *node = list->head;
+    void *data = node->data;
+    list->head = node->next;
+    if (list->head == NULL) {
+        list->tail = NULL;
+    }
+    list->size--;
+    list_release(list, node);
+    return data;
+}
+
+/*
+ * Moves every node of src to the end of dst; src is left empty. Both
+ * lists must take their nodes from the same place.
+ */
+void mx_list_concat(t_mx_list *dst, t_mx_list *src) {
+    MX_PROBE();
+    if (dst == NULL || src == NULL || src->head == NULL || dst == src
+        || dst->pool != src->pool) {
+        return;
+    }
+    if (dst->tail == NULL) {
+        dst->head = src->head;
+    } else {
+        dst->tail->next = src->head;
+    }
+    dst->tail = src->tail;
+    dst->size += src->size;
+    mx_list_init_pool(src, src->pool);
+}
+
+void mx_list_clear(t_mx_list *list) {
+    MX_PROBE();
+    if (list == NULL) {
+        return;
+    }
+    while (list->head != NULL) {
+        t_list *next = list->head->next;
+        list_release(list, list->head);
+        list->head = next;
+    }
+    mx_list_init_pool(list, list->pool);
+}
+
+// t_mx_dlist: a doubly-linked variant with O(1) operations at both ends
+void mx_dlist_init(t_mx_dlist *list) {
+    MX_PROBE();
+    if (list == NULL) {
+        return;
+    }
+    list->head = NULL;
+    list->tail = NULL;
+    list->size = 0;
+}
+
+t_mx_dnode *mx_dlist_push_front(t_mx_dlist *list, void *data) {
+    MX_PROBE();
+    if (list == NULL) {
+        return NULL;
+    }
+    t_mx_dnode *node = (t_mx_dnode *)MX_MALLOC(sizeof(t_mx_dnode));
+    if (node == NULL) {
+        return NULL;
+    }
+    node->data = data;
+    node->prev = NULL;
+    node->next = list->head;
+    if (list->head == NULL) {
+        list->tail = node;
+    } else {
+        list->head->prev = node;
+    }
+    list->head = node;
+    list->size++;
+    return node;
+}
+
+t_mx_dnode *mx_dlist_push_back(t_mx_dlist *list, void *data) {
+    MX_PROBE();
+    if (list == NULL) {
+        return NULL;
+    }
+    t_mx_dnode *node = (t_mx_dnode *)MX_MALLOC(sizeof(t_mx_dnode));
+    if (node == NULL) {
+        return NULL;
+    }
+    node->data = data;
+    node->next = NULL;
+    node->prev = list->tail;
+    if (list->tail == NULL) {
+        list->head = node;
+    } else {
+        list->tail->next = node;
+    }
+    list->tail = node;
+    list->size++;
+    return node;
+}
+
+// Unlinks node from list and frees it, returning its data
+void *mx_dlist_remove(t_mx_dlist *list, t_mx_dnode *node) {
+    MX_PROBE();
+    if (list == NULL || node == NULL) {
+        return NULL;
+    }
+    if (node->prev == NULL) {
+        list->head = node->next;
+    } else {
+        node->prev->next = node->next;
+    }
+    if (node->next == NULL) {
+        list->tail = node->prev;
+    } else {
+        node->next->prev = node->prev;
+    }
+    list->size--;
+    void *data = node->data;
+    MX_FREE(node);
+    return data;
+}
+
+void *mx_dlist_pop_front(t_mx_dlist *list) {
+    MX_PROBE();
+    if (list == NULL) {
+        return NULL;
+    }
+    return mx_dlist_remove(list, list->head);
+}
+
+void *mx_dlist_pop_back(t_mx_dlist *list) {
+    MX_PROBE();
+    if (list == NULL) {
+        return NULL;
+    }
+    return mx_dlist_remove(list, list->tail);
+}
+
+/*
+ * Moves every node of src into dst right after pos, or to the front of
+ * dst when pos is NULL. src is left empty.
+ */
+void mx_dlist_splice(t_mx_dlist *dst, t_mx_dnode *pos, t_mx_dlist *src) {
+    MX_PROBE();
+    if (dst == NULL || src == NULL || src->head == NULL || dst == src) {
+        return;
+    }
+    t_mx_dnode *after = pos ? pos->next : dst->head;
+
+    src->head->prev = pos;
+    src->tail->next = after;
+    if (pos == NULL) {
+        dst->head = src->head;
+    } else {
+        pos->next = src->head;
+    }
+    if (after == NULL) {
+        dst->tail = src->tail;
+    } else {
+        after->prev = src->tail;
+    }
+    dst->size += src->size;
+    mx_dlist_init(src);
+}
+
+void mx_dlist_concat(t_mx_dlist *dst, t_mx_dlist *src) {
+    MX_PROBE();
+    if (dst == NULL) {
+        return;
+    }
+    mx_dlist_splice(dst, dst->tail, src);
+}
+
+void mx_dlist_clear(t_mx_dlist *list) {
+    MX_PROBE();
+    if (list == NULL) {
+        return;
+    }
+    t_mx_dnode *node = list->head;
+    while (node != NULL) {
+        t_mx_dnode *next = node->next;
+        MX_FREE(node);
+        node = next;
+    }
+    mx_dlist_init(list);
+}
+
+/*
+ * Node pool: nodes are carved out of slabs of contiguous nodes, so a
+ * list built from one pool sits together in memory. Popped nodes go on a
+ * freelist threaded through their next field and are reused first.
+ * mx_node_pool_reset recycles every node at once and mx_node_pool_del
+ * returns the slabs to the heap.
+ */
+t_mx_node_pool *mx_node_pool_new(size_t slab_nodes) {
+    MX_PROBE();
+    t_mx_node_pool *pool = (t_mx_node_pool *)MX_MALLOC(sizeof(t_mx_node_pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+    pool->slab_nodes = slab_nodes ? slab_nodes : MX_NODE_POOL_SLAB;
+    return pool;
+}
+
+static t_list *pool_get(t_mx_node_pool *pool) {
+    t_list *node = pool->free_list;
+    if (node != NULL) {
+        pool->free_list = node->next;
+        return node;
+    }
+
+    t_mx_node_slab *slab = pool->slabs;
+    if (slab == NULL || slab->used == slab->count) {
+        slab = (t_mx_node_slab *)MX_MALLOC(sizeof(t_mx_node_slab)
+                                           + pool->slab_nodes * sizeof(t_list));
+        if (slab == NULL) {
+            return NULL;
+        }
+        slab->count = pool->slab_nodes;
+        slab->used = 0;
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+    }
+    return &slab->nodes[slab->used++];
+}
+
+void mx_node_pool_put(t_mx_node_pool *pool, t_list *node) {
+    MX_PROBE();
+    if (pool == NULL || node == NULL) {
+        return;
+    }
+    node->next = pool->free_list;
+    pool->free_list = node;
+}
+
+/*
+ * Makes every node of every slab available again. Only the newest slab
+ * is bumped from, so the older ones are handed out through the freelist.
+ */
+void mx_node_pool_reset(t_mx_node_pool *pool) {
+    MX_PROBE();
+    if (pool == NULL || pool->slabs == NULL) {
+        return;
+    }
+    pool->free_list = NULL;
+    for (t_mx_node_slab *slab = pool->slabs->next; slab; slab = slab->next) {
+        for (size_t i = slab->count; i > 0; i--) {
+            slab->nodes[i - 1].next = pool->free_list;
+            pool->free_list = &slab->nodes[i - 1];
+        }
+    }
+    pool->slabs->used = 0;
+}
+
+void mx_node_pool_del(t_mx_node_pool **pool) {
+    MX_PROBE();
+    if (pool == NULL || *pool == NULL) {
+        return;
+    }
+    t_mx_node_slab *slab = (*pool)->slabs;
+    while (slab != NULL) {
+        t_mx_node_slab *next = slab->next;
+        MX_FREE(slab);
+        slab = next;
+    }
+    MX_FREE(*pool);
+    *pool = NULL;
+}
+
+t_list *mx_create_node_pool(t_mx_node_pool *pool, void *data) {
+    MX_PROBE();
+    if (pool == NULL) {
+        return NULL;
+    }
+    t_list *node = pool_get(pool);
+    if (node == NULL) {
+        return NULL;
+    }
+    node->data = data;
+    node->next = NULL;
+    return node;
+}
+
+void mx_push_front_pool(t_mx_node_pool *pool, t_list **list, void *data) {
+    MX_PROBE();
+    if (list == NULL) {
+        return;
+    }
+    t_list *node = mx_create_node_pool(pool, data);
+    if (node == NULL) {
+        return;
+    }
+    node->next = *list;
+    *list = node;
+}
+
+void mx_push_back_pool(t_mx_node_pool *pool, t_list **list, void *data) {
+    MX_PROBE();
+    if (list == NULL) {
+        return;
+    }
+    t_list *node = mx_create_node_pool(pool, data);
+    if (node == NULL) {
+        return;
+    }
+    if (*list == NULL) {
+        *list = node;
+        return;
+    }
+    t_list *last = *list;
+    while (last->next != NULL) {
+        last = last->next;
+    }
+    last->next = node;
+}
+
+void mx_pop_front_pool(t_mx_node_pool *pool, t_list **head) {
+    MX_PROBE();
+    if (pool == NULL || head == NULL || *head == NULL) {
+        return;
+    }
+    t_list *temp = (*head)->next;
+    mx_node_pool_put(pool, *head);
+    *head = temp;
+}
+
+void mx_pop_back_pool(t_mx_node_pool *pool, t_list **head) {
+    MX_PROBE();
+    if (pool == NULL || head == NULL || *head == NULL) {
+        return;
+    }
+    t_list **last = head;
+    while ((*last)->next != NULL) {
+        last = &(*last)->next;
+    }
+    mx_node_pool_put(pool, *last);
+    *last = NULL;
+}
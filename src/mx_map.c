@@ -0,0 +1,334 @@
+/**
+ * @file mx_map.c
+ * @brief Hash map from C strings to data pointers.
+ *
+ * Open addressing with Robin Hood probing. Each slot stores the key
+ * pointer, its length, a 32-bit hash and the probe distance from the
+ * slot the hash maps to, so most mismatches are rejected without
+ * touching the key, and lookups stop as soon as they meet an entry that
+ * sits closer to its home than the key would. Removal shifts the
+ * following entries back instead of leaving tombstones.
+ *
+ * Growing is incremental: the full table is kept as the old table, a
+ * twice larger one becomes current, and every insert or removal moves
+ * a few old slots over. Lookups consult both tables while that lasts.
+ * Slots below migrate_pos in the old table have been moved already, so
+ * probes step over them instead of stopping there.
+ *
+ * Keys are copied. With an arena they are copied into it and live until
+ * the arena is reset; otherwise they are malloc'd and freed with the
+ * entry.
+ *
+ * Functions:
+ * - t_mx_map *mx_map_new(t_mx_arena *arena): Creates a map, keys copied into arena when not NULL.
+ * - int mx_map_set(t_mx_map *map, const char *key, void *value): Inserts or updates key.
+ * - void *mx_map_get(const t_mx_map *map, const char *key): Returns the value of key or NULL.
+ * - bool mx_map_has(const t_mx_map *map, const char *key): Tells whether key is present.
+ * - bool mx_map_remove(t_mx_map *map, const char *key): Removes key, false when absent.
+ * - void mx_map_iter(const t_mx_map *map, t_mx_map_iter *it): Starts an iteration.
+ * - bool mx_map_next(t_mx_map_iter *it, const char **key, void **value): Yields the next entry.
+ * - void mx_map_del(t_mx_map **map): Frees the map and sets the pointer to NULL.
+ */
+
+#include "../inc/libmx.h"
+
+#define MX_MAP_MIN_CAP 16
+// Old slots moved to the current table on every insert or removal
+#define MX_MAP_MIGRATE 16
+
+typedef size_t __attribute__((__may_alias__, __aligned__(1))) t_mx_uword;
+
+static uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Eight bytes per multiply, finished with the murmur3 avalanche
+static uint32_t hash_key(const char *s, size_t len) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+    size_t i = 0;
+
+    for (; i + sizeof(size_t) <= len; i += sizeof(size_t)) {
+        h = (h ^ *(const t_mx_uword *)(s + i)) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    for (size_t k = 0; i + k < len; k++) {
+        tail |= (uint64_t)(unsigned char)s[i + k] << (8 * k);
+    }
+    return (uint32_t)hash_mix(h ^ tail);
+}
+
+static bool table_init(t_mx_map_table *t, size_t cap) {
+    t->slots = (t_mx_map_slot *)MX_MALLOC(cap * sizeof(t_mx_map_slot));
+    if (t->slots == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < cap; i++) {
+        t->slots[i].dist = 0;
+    }
+    t->cap = cap;
+    t->count = 0;
+    return true;
+}
+
+/*
+ * Returns the slot index of the key or -1. Slots below skip are known
+ * to be empty but not the end of a probe sequence.
+ */
+static long table_find(const t_mx_map_table *t, size_t skip,
+                       const char *key, size_t len, uint32_t hash) {
+    if (t->slots == NULL || t->count == 0) {
+        return -1;
+    }
+
+    size_t mask = t->cap - 1;
+    size_t i = hash & mask;
+    for (uint32_t dist = 1; dist <= t->cap; dist++, i = (i + 1) & mask) {
+        const t_mx_map_slot *s = &t->slots[i];
+        if (i < skip) {
+            continue;
+        }
+        if (s->dist < dist) {
+            return -1;
+        }
+        if (s->hash == hash && s->len == len
+            && mx_memcmp(s->key, key, len) == 0) {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+// The key must be absent and the table must have a free slot
+static void table_insert(t_mx_map_table *t, t_mx_map_slot entry) {
+    size_t mask = t->cap - 1;
+    size_t i = entry.hash & mask;
+
+    entry.dist = 1;
+    while (t->slots[i].dist != 0) {
+        if (t->slots[i].dist < entry.dist) {
+            t_mx_map_slot rich = t->slots[i];
+            t->slots[i] = entry;
+            entry = rich;
+        }
+        entry.dist++;
+        i = (i + 1) & mask;
+    }
+    t->slots[i] = entry;
+    t->count++;
+}
+
+static void table_erase(t_mx_map_table *t, size_t i) {
+    size_t mask = t->cap - 1;
+    size_t next = (i + 1) & mask;
+
+    while (t->slots[next].dist > 1) {
+        t->slots[i] = t->slots[next];
+        t->slots[i].dist--;
+        i = next;
+        next = (next + 1) & mask;
+    }
+    t->slots[i].dist = 0;
+    t->count--;
+}
+
+static void migrate(t_mx_map *map, size_t steps) {
+    if (map->old.slots == NULL) {
+        return;
+    }
+
+    for (; steps > 0 && map->migrate_pos < map->old.cap; steps--) {
+        t_mx_map_slot *s = &map->old.slots[map->migrate_pos++];
+        if (s->dist != 0) {
+            table_insert(&map->cur, *s);
+            s->dist = 0;
+            map->old.count--;
+        }
+    }
+    if (map->migrate_pos == map->old.cap) {
+        MX_FREE(map->old.slots);
+        map->old.slots = NULL;
+        map->old.cap = 0;
+        map->old.count = 0;
+    }
+}
+
+// Keeps the load of the current table at or below 7/8
+static bool reserve_one(t_mx_map *map) {
+    if (map->cur.slots != NULL
+        && (map->cur.count + 1) * 8 <= map->cur.cap * 7) {
+        return true;
+    }
+    if (map->old.slots != NULL) {
+        migrate(map, map->old.cap);
+    }
+
+    size_t cap = map->cur.slots ? map->cur.cap * 2 : MX_MAP_MIN_CAP;
+    t_mx_map_table next;
+    if (!table_init(&next, cap)) {
+        return false;
+    }
+    if (map->cur.slots != NULL) {
+        map->old = map->cur;
+        map->migrate_pos = 0;
+    }
+    map->cur = next;
+    return true;
+}
+
+t_mx_map *mx_map_new(t_mx_arena *arena) {
+    MX_PROBE();
+    t_mx_map *map = (t_mx_map *)MX_MALLOC(sizeof(t_mx_map));
+    if (map == NULL) {
+        return NULL;
+    }
+
+    map->cur.slots = NULL;
+    map->cur.cap = 0;
+    map->cur.count = 0;
+    map->old = map->cur;
+    map->migrate_pos = 0;
+    map->size = 0;
+    map->arena = arena;
+    return map;
+}
+
+static t_mx_map_slot *map_find(const t_mx_map *map, const char *key) {
+    size_t len = (size_t)mx_strlen(key);
+    uint32_t hash = hash_key(key, len);
+    long i = table_find(&map->cur, 0, key, len, hash);
+
+    if (i >= 0) {
+        return &map->cur.slots[i];
+    }
+    i = table_find(&map->old, map->migrate_pos, key, len, hash);
+    return i >= 0 ? &map->old.slots[i] : NULL;
+}
+
+int mx_map_set(t_mx_map *map, const char *key, void *value) {
+    MX_PROBE();
+    if (map == NULL || key == NULL) {
+        return -1;
+    }
+
+    t_mx_map_slot *found = map_find(map, key);
+    if (found != NULL) {
+        found->value = value;
+        return 0;
+    }
+    if (!reserve_one(map)) {
+        return -1;
+    }
+
+    t_mx_map_slot entry;
+    entry.len = (size_t)mx_strlen(key);
+    entry.hash = hash_key(key, entry.len);
+    entry.value = value;
+    if (map->arena != NULL) {
+        entry.key = mx_arena_strndup(map->arena, key, entry.len);
+    } else {
+        char *copy = (char *)MX_MALLOC(entry.len + 1);
+        if (copy != NULL) {
+            mx_memcpy(copy, key, entry.len + 1);
+        }
+        entry.key = copy;
+    }
+    if (entry.key == NULL) {
+        return -1;
+    }
+    table_insert(&map->cur, entry);
+    map->size++;
+    migrate(map, MX_MAP_MIGRATE);
+    return 0;
+}
+
+void *mx_map_get(const t_mx_map *map, const char *key) {
+    if (map == NULL || key == NULL) {
+        return NULL;
+    }
+
+    t_mx_map_slot *found = map_find(map, key);
+    return found ? found->value : NULL;
+}
+
+bool mx_map_has(const t_mx_map *map, const char *key) {
+    return map != NULL && key != NULL && map_find(map, key) != NULL;
+}
+
+bool mx_map_remove(t_mx_map *map, const char *key) {
+    MX_PROBE();
+    if (map == NULL || key == NULL) {
+        return false;
+    }
+
+    t_mx_map_slot *found = map_find(map, key);
+    if (found == NULL) {
+        return false;
+    }
+    if (map->arena == NULL) {
+        MX_FREE((char *)found->key);
+    }
+    if (found >= map->cur.slots && found < map->cur.slots + map->cur.cap) {
+        table_erase(&map->cur, found - map->cur.slots);
+    } else {
+        table_erase(&map->old, found - map->old.slots);
+    }
+    map->size--;
+    migrate(map, MX_MAP_MIGRATE);
+    return true;
+}
+
+void mx_map_iter(const t_mx_map *map, t_mx_map_iter *it) {
+    if (it == NULL) {
+        return;
+    }
+    it->map = map;
+    it->table = 0;
+    it->idx = 0;
+}
+
+bool mx_map_next(t_mx_map_iter *it, const char **key, void **value) {
+    if (it == NULL || it->map == NULL) {
+        return false;
+    }
+
+    for (; it->table < 2; it->table++, it->idx = 0) {
+        const t_mx_map_table *t = it->table == 0 ? &it->map->cur
+                                                 : &it->map->old;
+        while (it->idx < t->cap) {
+            const t_mx_map_slot *s = &t->slots[it->idx++];
+            if (s->dist != 0) {
+                if (key != NULL) *key = s->key;
+                if (value != NULL) *value = s->value;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void mx_map_del(t_mx_map **map) {
+    MX_PROBE();
+    if (map == NULL || *map == NULL) {
+        return;
+    }
+
+    t_mx_map_table *tables[2] = {&(*map)->cur, &(*map)->old};
+    for (int k = 0; k < 2; k++) {
+        if ((*map)->arena == NULL) {
+            for (size_t i = 0; i < tables[k]->cap; i++) {
+                if (tables[k]->slots[i].dist != 0) {
+                    MX_FREE((char *)tables[k]->slots[i].key);
+                }
+            }
+        }
+        MX_FREE(tables[k]->slots);
+    }
+    MX_FREE(*map);
+    *map = NULL;
+}
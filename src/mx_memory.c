@@ -1,60 +1,485 @@
 #include "../inc/libmx.h"
 
-void *mx_memset(void *b, int c, size_t len) {
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MX_HAVE_X86 1
+#endif
+
+/*
+ * Word-at-a-time helpers. Loads and stores go through t_mx_uword, which
+ * may alias anything and has byte alignment, so the compiler emits plain
+ * unaligned moves on x86 and safe byte sequences elsewhere.
+ */
+typedef size_t __attribute__((__may_alias__, __aligned__(1))) t_mx_uword;
+
+#define MX_WORD sizeof(size_t)
+#define MX_ONES ((size_t)-1 / 0xFF)
+#define MX_HIGHS (MX_ONES * 0x80)
+#define MX_HAS_ZERO(x) (((x) - MX_ONES) & ~(x) & MX_HIGHS)
+
+// Copies and fills at least this large bypass the cache with streaming stores
+#define MX_NT_THRESHOLD ((size_t)1 << 20)
+
+static void *memset_word(void *b, int c, size_t len) {
     unsigned char *p = b;
+    size_t w = MX_ONES * (unsigned char)c;
+
+    while (len > 0 && ((uintptr_t)p & (MX_WORD - 1))) {
+        *p++ = (unsigned char)c;
+        len--;
+    }
+    for (; len >= MX_WORD; len -= MX_WORD, p += MX_WORD) {
+        *(t_mx_uword *)p = w;
+    }
     while (len--) {
         *p++ = (unsigned char)c;
     }
     return b;
 }
 
-void *mx_memcpy(void *restrict dst, const void *restrict src, size_t n) {
-    if (dst == NULL || src == NULL) {
-        return NULL;
+static void *memcpy_word(void *restrict dst, const void *restrict src,
+                         size_t n) {
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+
+    while (n > 0 && ((uintptr_t)d & (MX_WORD - 1))) {
+        *d++ = *s++;
+        n--;
+    }
+    for (; n >= 4 * MX_WORD; n -= 4 * MX_WORD) {
+        size_t w0 = ((const t_mx_uword *)s)[0];
+        size_t w1 = ((const t_mx_uword *)s)[1];
+        size_t w2 = ((const t_mx_uword *)s)[2];
+        size_t w3 = ((const t_mx_uword *)s)[3];
+        ((t_mx_uword *)d)[0] = w0;
+        ((t_mx_uword *)d)[1] = w1;
+        ((t_mx_uword *)d)[2] = w2;
+        ((t_mx_uword *)d)[3] = w3;
+        d += 4 * MX_WORD;
+        s += 4 * MX_WORD;
+    }
+    for (; n >= MX_WORD; n -= MX_WORD, d += MX_WORD, s += MX_WORD) {
+        *(t_mx_uword *)d = *(const t_mx_uword *)s;
+    }
+    while (n--) {
+        *d++ = *s++;
     }
+    return dst;
+}
+
+static int memcmp_word(const void *s1, const void *s2, size_t n) {
+    const unsigned char *p1 = s1;
+    const unsigned char *p2 = s2;
+    size_t i = 0;
 
+    while (i + MX_WORD <= n
+           && *(const t_mx_uword *)(p1 + i) == *(const t_mx_uword *)(p2 + i)) {
+        i += MX_WORD;
+    }
+    for (; i < n; i++) {
+        if (p1[i] != p2[i]) {
+            return p1[i] - p2[i];
+        }
+    }
+    return 0;
+}
+
+static void *memchr_word(const void *s, int c, size_t n) {
+    const unsigned char *p = s;
+    unsigned char ch = (unsigned char)c;
+    size_t pattern = MX_ONES * ch;
+
+    while (n > 0 && ((uintptr_t)p & (MX_WORD - 1))) {
+        if (*p == ch) {
+            return (void *)p;
+        }
+        p++;
+        n--;
+    }
+    for (; n >= MX_WORD; n -= MX_WORD, p += MX_WORD) {
+        size_t x = *(const t_mx_uword *)p ^ pattern;
+        if (MX_HAS_ZERO(x)) {
+            break;
+        }
+    }
+    for (; n > 0; n--, p++) {
+        if (*p == ch) {
+            return (void *)p;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Overlap-safe copy. Unlike the memcpy kernels these take no restrict
+ * pointers, so every load stays ordered before the store that may clobber it.
+ */
+static void *memmove_word(void *dst, const void *src, size_t n) {
     unsigned char *d = dst;
     const unsigned char *s = src;
-    for (size_t i = 0; i < n; i++) {
-        d[i] = s[i];
+
+    if (d < s) {
+        for (; n >= MX_WORD; n -= MX_WORD, d += MX_WORD, s += MX_WORD) {
+            *(t_mx_uword *)d = *(const t_mx_uword *)s;
+        }
+        while (n--) {
+            *d++ = *s++;
+        }
+    } else if (d > s) {
+        d += n;
+        s += n;
+        for (; n >= MX_WORD; n -= MX_WORD) {
+            d -= MX_WORD;
+            s -= MX_WORD;
+            *(t_mx_uword *)d = *(const t_mx_uword *)s;
+        }
+        while (n--) {
+            *--d = *--s;
+        }
     }
     return dst;
 }
 
-void *mx_memccpy(void *restrict dst, const void *restrict src, int c, size_t n) {
-    if (dst == NULL || src == NULL) {
-        return NULL;
+#ifdef MX_HAVE_X86
+
+/*
+ * SSE2 kernels. Buffers of at least one vector are handled with a vector
+ * loop and one overlapping vector for the tail; shorter ones fall back to
+ * the word kernels.
+ */
+__attribute__((target("sse2")))
+static void *memset_sse2(void *b, int c, size_t len) {
+    if (len < 16) {
+        return memset_word(b, c, len);
+    }
+    unsigned char *p = b;
+    unsigned char *end = p + len;
+    __m128i v = _mm_set1_epi8((char)c);
+
+    _mm_storeu_si128((__m128i *)p, v);
+    p = (unsigned char *)(((uintptr_t)p + 16) & ~(uintptr_t)15);
+    if (len >= MX_NT_THRESHOLD) {
+        for (; p + 16 <= end; p += 16) {
+            _mm_stream_si128((__m128i *)p, v);
+        }
+        _mm_sfence();
+    } else {
+        for (; p + 16 <= end; p += 16) {
+            _mm_store_si128((__m128i *)p, v);
+        }
+    }
+    _mm_storeu_si128((__m128i *)(end - 16), v);
+    return b;
+}
+
+__attribute__((target("sse2")))
+static void *memcpy_sse2(void *restrict dst, const void *restrict src,
+                         size_t n) {
+    if (n < 16) {
+        return memcpy_word(dst, src, n);
     }
     unsigned char *d = dst;
     const unsigned char *s = src;
-    for (size_t i = 0; i < n; i++) {
-        d[i] = s[i];
-        if (s[i] == (unsigned char)c) {
-            return &d[i + 1];
+    __m128i head = _mm_loadu_si128((const __m128i *)s);
+    __m128i tail = _mm_loadu_si128((const __m128i *)(s + n - 16));
+    size_t skew = 16 - ((uintptr_t)d & 15);
+    unsigned char *end = d + n;
+
+    d += skew;
+    s += skew;
+    if (n >= MX_NT_THRESHOLD) {
+        for (; d + 16 <= end; d += 16, s += 16) {
+            _mm_stream_si128((__m128i *)d,
+                             _mm_loadu_si128((const __m128i *)s));
+        }
+        _mm_sfence();
+    } else {
+        for (; d + 16 <= end; d += 16, s += 16) {
+            _mm_store_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
         }
     }
-    return NULL;
+    _mm_storeu_si128((__m128i *)dst, head);
+    _mm_storeu_si128((__m128i *)(end - 16), tail);
+    return dst;
 }
-int mx_memcmp(const void *s1, const void *s2, size_t n) {
+
+__attribute__((target("sse2")))
+static int memcmp_sse2(const void *s1, const void *s2, size_t n) {
     const unsigned char *p1 = s1;
     const unsigned char *p2 = s2;
-    for (size_t i = 0; i < n; i++) {
-        if (p1[i] != p2[i]) {
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p1 + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(p2 + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+        if (mask != 0xFFFF) {
+            i += __builtin_ctz(~mask);
             return p1[i] - p2[i];
         }
     }
-    return 0;
+    return memcmp_word(p1 + i, p2 + i, n - i);
 }
-void *mx_memchr(const void *s, int c, size_t n) {
+
+__attribute__((target("sse2")))
+static void *memchr_sse2(const void *s, int c, size_t n) {
+    const unsigned char *p = s;
+    __m128i v = _mm_set1_epi8((char)c);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+        if (mask) {
+            return (void *)(p + i + __builtin_ctz(mask));
+        }
+    }
+    return memchr_word(p + i, c, n - i);
+}
+
+/*
+ * Up to two vectors are loaded before anything is stored. Longer moves
+ * keep the vector that the direction of travel reaches last in a register
+ * and store it at the end.
+ */
+__attribute__((target("sse2")))
+static void *memmove_sse2(void *dst, const void *src, size_t n) {
+    if (n < 16) {
+        return memmove_word(dst, src, n);
+    }
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+    __m128i head = _mm_loadu_si128((const __m128i *)s);
+    __m128i tail = _mm_loadu_si128((const __m128i *)(s + n - 16));
+
+    if (n > 32) {
+        if (d < s) {
+            for (size_t i = 0; i + 16 < n; i += 16) {
+                _mm_storeu_si128((__m128i *)(d + i),
+                                 _mm_loadu_si128((const __m128i *)(s + i)));
+            }
+        } else {
+            for (size_t i = n - 16; i > 0; i = i > 16 ? i - 16 : 0) {
+                _mm_storeu_si128((__m128i *)(d + i),
+                                 _mm_loadu_si128((const __m128i *)(s + i)));
+            }
+        }
+    }
+    _mm_storeu_si128((__m128i *)d, head);
+    _mm_storeu_si128((__m128i *)(d + n - 16), tail);
+    return dst;
+}
+
+/*
+ * AVX2 kernels, same structure as the SSE2 ones with 32-byte vectors.
+ * Short lengths and tails go to the SSE2 kernels, which are not VEX
+ * encoded: the upper halves of the ymm registers are cleared before
+ * each hand-off, or every SSE instruction there pays the AVX-SSE
+ * transition penalty. The compiler only does this at a return.
+ */
+__attribute__((target("avx2")))
+static void *memset_avx2(void *b, int c, size_t len) {
+    if (len < 32) {
+        _mm256_zeroupper();
+        return memset_sse2(b, c, len);
+    }
+    unsigned char *p = b;
+    unsigned char *end = p + len;
+    __m256i v = _mm256_set1_epi8((char)c);
+
+    _mm256_storeu_si256((__m256i *)p, v);
+    p = (unsigned char *)(((uintptr_t)p + 32) & ~(uintptr_t)31);
+    if (len >= MX_NT_THRESHOLD) {
+        for (; p + 32 <= end; p += 32) {
+            _mm256_stream_si256((__m256i *)p, v);
+        }
+        _mm_sfence();
+    } else {
+        for (; p + 32 <= end; p += 32) {
+            _mm256_store_si256((__m256i *)p, v);
+        }
+    }
+    _mm256_storeu_si256((__m256i *)(end - 32), v);
+    return b;
+}
+
+__attribute__((target("avx2")))
+static void *memcpy_avx2(void *restrict dst, const void *restrict src,
+                         size_t n) {
+    if (n < 32) {
+        _mm256_zeroupper();
+        return memcpy_sse2(dst, src, n);
+    }
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+    __m256i head = _mm256_loadu_si256((const __m256i *)s);
+    __m256i tail = _mm256_loadu_si256((const __m256i *)(s + n - 32));
+    size_t skew = 32 - ((uintptr_t)d & 31);
+    unsigned char *end = d + n;
+
+    d += skew;
+    s += skew;
+    if (n >= MX_NT_THRESHOLD) {
+        for (; d + 32 <= end; d += 32, s += 32) {
+            _mm256_stream_si256((__m256i *)d,
+                                _mm256_loadu_si256((const __m256i *)s));
+        }
+        _mm_sfence();
+    } else {
+        for (; d + 32 <= end; d += 32, s += 32) {
+            _mm256_store_si256((__m256i *)d,
+                               _mm256_loadu_si256((const __m256i *)s));
+        }
+    }
+    _mm256_storeu_si256((__m256i *)dst, head);
+    _mm256_storeu_si256((__m256i *)(end - 32), tail);
+    return dst;
+}
+
+__attribute__((target("avx2")))
+static int memcmp_avx2(const void *s1, const void *s2, size_t n) {
+    const unsigned char *p1 = s1;
+    const unsigned char *p2 = s2;
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p1 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p2 + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+        if (mask != 0xFFFFFFFFu) {
+            i += __builtin_ctz(~mask);
+            return p1[i] - p2[i];
+        }
+    }
+    _mm256_zeroupper();
+    return memcmp_sse2(p1 + i, p2 + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void *memchr_avx2(const void *s, int c, size_t n) {
     const unsigned char *p = s;
+    __m256i v = _mm256_set1_epi8((char)c);
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v));
+        if (mask) {
+            return (void *)(p + i + __builtin_ctz(mask));
+        }
+    }
+    _mm256_zeroupper();
+    return memchr_sse2(p + i, c, n - i);
+}
+
+__attribute__((target("avx2")))
+static void *memmove_avx2(void *dst, const void *src, size_t n) {
+    if (n < 32) {
+        _mm256_zeroupper();
+        return memmove_sse2(dst, src, n);
+    }
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+    __m256i head = _mm256_loadu_si256((const __m256i *)s);
+    __m256i tail = _mm256_loadu_si256((const __m256i *)(s + n - 32));
+
+    if (n > 64) {
+        if (d < s) {
+            for (size_t i = 0; i + 32 < n; i += 32) {
+                _mm256_storeu_si256((__m256i *)(d + i),
+                                    _mm256_loadu_si256((const __m256i *)(s + i)));
+            }
+        } else {
+            for (size_t i = n - 32; i > 0; i = i > 32 ? i - 32 : 0) {
+                _mm256_storeu_si256((__m256i *)(d + i),
+                                    _mm256_loadu_si256((const __m256i *)(s + i)));
+            }
+        }
+    }
+    _mm256_storeu_si256((__m256i *)d, head);
+    _mm256_storeu_si256((__m256i *)(d + n - 32), tail);
+    return dst;
+}
+
+#endif /* MX_HAVE_X86 */
+
+/*
+ * Kernel table. It starts out pointing at the portable word kernels so
+ * that calls made before the constructor has run are still correct, and
+ * is upgraded once at load time from CPUID.
+ */
+static struct {
+    void *(*set)(void *, int, size_t);
+    void *(*cpy)(void *restrict, const void *restrict, size_t);
+    int (*cmp)(const void *, const void *, size_t);
+    void *(*chr)(const void *, int, size_t);
+    void *(*mov)(void *, const void *, size_t);
+} mem_ops = {memset_word, memcpy_word, memcmp_word, memchr_word, memmove_word};
+
+__attribute__((constructor))
+static void mem_ops_init(void) {
+#ifdef MX_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        mem_ops.set = memset_avx2;
+        mem_ops.cpy = memcpy_avx2;
+        mem_ops.cmp = memcmp_avx2;
+        mem_ops.chr = memchr_avx2;
+        mem_ops.mov = memmove_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        mem_ops.set = memset_sse2;
+        mem_ops.cpy = memcpy_sse2;
+        mem_ops.cmp = memcmp_sse2;
+        mem_ops.chr = memchr_sse2;
+        mem_ops.mov = memmove_sse2;
+    }
+#endif
+}
+
+void *mx_memset(void *b, int c, size_t len) {
+    MX_PROBE();
+    MX_PROBE_BYTES(len);
+    return mem_ops.set(b, c, len);
+}
+
+void *mx_memcpy(void *restrict dst, const void *restrict src, size_t n) {
+    MX_PROBE();
+    MX_PROBE_BYTES(n);
+    if (dst == NULL || src == NULL) {
+        return NULL;
+    }
+    return mem_ops.cpy(dst, src, n);
+}
+
+void *mx_memccpy(void *restrict dst, const void *restrict src, int c, size_t n) {
+    MX_PROBE();
+    MX_PROBE_BYTES(n);
+    if (dst == NULL || src == NULL) {
+        return NULL;
+    }
+    unsigned char *d = dst;
+    const unsigned char *s = src;
     for (size_t i = 0; i < n; i++) {
-        if (p[i] == (unsigned char)c) {
-            return (void *)&p[i];
+        d[i] = s[i];
+        if (s[i] == (unsigned char)c) {
+            return &d[i + 1];
         }
     }
     return NULL;
 }
+int mx_memcmp(const void *s1, const void *s2, size_t n) {
+    MX_PROBE();
+    MX_PROBE_BYTES(n);
+    return mem_ops.cmp(s1, s2, n);
+}
+void *mx_memchr(const void *s, int c, size_t n) {
+    MX_PROBE();
+    MX_PROBE_BYTES(n);
+    return mem_ops.chr(s, c, n);
+}
 void *mx_memrchr(const void *s, int c, size_t n) {
+    MX_PROBE();
+    MX_PROBE_BYTES(n);
     const unsigned char *p = s;
     for (size_t i = n; i > 0; i--) {
         if (p[i] == (unsigned char)c) {
@@ -63,48 +488,64 @@ void *mx_memrchr(const void *s, int c, size_t n) {
     }
     return NULL;
 }
-void *mx_memmem(const void *big, size_t big_len, const void *little, 
+void *mx_memmem(const void *big, size_t big_len, const void *little,
                 size_t little_len) {
-    const unsigned char *b = big;
-    const unsigned char *l = little;
-    for (size_t i = 0; i < big_len; i++) {
-        if (b[i] == l[0]) {
-            if (mx_memcmp(&b[i], l, little_len) == 0) {
-                return (void *)&b[i];
-            }
-        }
+    MX_PROBE();
+    MX_PROBE_BYTES(big_len);
+    if (big == NULL || little == NULL) {
+        return NULL;
     }
-    return NULL;
+    t_mx_needle needle;
+    mx_needle_init(&needle, little, little_len);
+    return mx_needle_find(&needle, big, big_len);
 }
 void *mx_memmove(void *dst, const void *src, size_t len) {
-    unsigned char *d = dst;
-    const unsigned char *s = src;
-    unsigned char *temp = (unsigned char *)malloc(len);
-    if (temp == NULL) {
+    MX_PROBE();
+    MX_PROBE_BYTES(len);
+    if (dst == NULL || src == NULL) {
         return NULL;
     }
-    for (size_t i = 0; i < len; i++) {
-        temp[i] = s[i];
-    }
-    for (size_t i = 0; i < len; i++) {
-        d[i] = temp[i];
+    uintptr_t d = (uintptr_t)dst;
+    uintptr_t s = (uintptr_t)src;
+    if (d - s >= len && s - d >= len) {
+        return mem_ops.cpy(dst, src, len);
     }
-    free(temp);
-    return dst;
+    return mem_ops.mov(dst, src, len);
 }
 void *mx_realloc(void *ptr, size_t size) {
+    MX_PROBE();
+    MX_PROBE_BYTES(size);
     if (ptr == NULL) {
-        return malloc(size);
+        return MX_MALLOC(size);
     }
     if (size == 0) {
-        free(ptr);
+        MX_FREE(ptr);
         return NULL;
     }
-    void *new_ptr = malloc(size);
+    size_t usable = malloc_usable_size(ptr);
+    if (usable >= size) {
+        return ptr;
+    }
+    void *new_ptr = MX_MALLOC(size);
     if (new_ptr == NULL) {
         return NULL;
     }
-    mx_memcpy(new_ptr, ptr, size);
-    free(ptr);
-    return new_ptr; 
+    mx_memcpy(new_ptr, ptr, usable);
+    MX_FREE(ptr);
+    return new_ptr;
+}
+
+/*
+ * Like mx_realloc, but when the block has to move it at least doubles,
+ * so a sequence of small appends costs amortized O(1) per byte.
+ */
+void *mx_realloc_grow(void *ptr, size_t size) {
+    MX_PROBE();
+    MX_PROBE_BYTES(size);
+    size_t usable = ptr ? malloc_usable_size(ptr) : 0;
+    if (ptr != NULL && usable >= size) {
+        return ptr;
+    }
+    size_t cap = usable > SIZE_MAX / 2 ? SIZE_MAX : usable * 2;
+    return mx_realloc(ptr, cap > size ? cap : size);
 }
@@ -0,0 +1,151 @@
+/**
+ * @file mx_output.c
+ * @brief Buffered, batched writer for standard output.
+ *
+ * Every mx_print* function goes through mx_out_write. By default that
+ * writes straight to fd 1, so output stays in order with write(),
+ * printf and stderr. After mx_out_setbuf with MX_OUT_LINE or MX_OUT_FULL
+ * it appends to one process-wide buffer instead of issuing a write per
+ * call. The buffer is flushed when it fills, on newlines in
+ * line-buffered mode, on an explicit mx_out_flush and at exit. Writes
+ * that do not fit are gathered with the pending buffer into a single
+ * writev.
+ *
+ * A caller that enables buffering must call mx_out_flush before writing
+ * to fd 1 by other means. The buffer has no locking, so buffered output
+ * must only be used from one thread at a time.
+ *
+ * Functions:
+ * - int mx_out_setbuf(size_t size, t_mx_out_mode mode): Sets the buffer size and buffering mode.
+ * - void mx_out_write(const void *data, size_t len): Appends bytes to standard output.
+ * - void mx_out_putc(char c): Appends a single byte to standard output.
+ * - void mx_out_flush(void): Writes out everything buffered so far.
+ */
+
+#include "../inc/libmx.h"
+
+#define MX_OUT_FD 1
+#define MX_OUT_DEFAULT_SIZE 8192
+
+static char default_buf[MX_OUT_DEFAULT_SIZE];
+
+static struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    t_mx_out_mode mode;
+    bool at_exit;
+} out = {default_buf, MX_OUT_DEFAULT_SIZE, 0, MX_OUT_NONE, false};
+
+/*
+ * Writes both ranges with as few syscalls as possible, resuming after
+ * short writes. On an error the remaining bytes are dropped, as there is
+ * nobody to report them to.
+ */
+static void write_all(const char *a, size_t alen, const char *b, size_t blen) {
+    struct iovec iov[2] = {
+        {(void *)a, alen},
+        {(void *)b, blen},
+    };
+    struct iovec *cur = alen ? iov : iov + 1;
+    int count = alen ? 2 : 1;
+
+    while (count > 0) {
+        ssize_t done = writev(MX_OUT_FD, cur, count);
+        if (done <= 0) {
+            return;
+        }
+        while (count > 0 && (size_t)done >= cur->iov_len) {
+            done -= cur->iov_len;
+            cur++;
+            count--;
+        }
+        if (count > 0) {
+            cur->iov_base = (char *)cur->iov_base + done;
+            cur->iov_len -= done;
+        }
+    }
+}
+
+static void out_at_exit(void) {
+    mx_out_flush();
+}
+
+static void register_at_exit(void) {
+    if (!out.at_exit) {
+        out.at_exit = true;
+        atexit(out_at_exit);
+    }
+}
+
+void mx_out_flush(void) {
+    if (out.len > 0) {
+        write_all(out.buf, out.len, NULL, 0);
+        out.len = 0;
+    }
+}
+
+int mx_out_setbuf(size_t size, t_mx_out_mode mode) {
+    MX_PROBE();
+    mx_out_flush();
+    if (size == 0) {
+        size = MX_OUT_DEFAULT_SIZE;
+    }
+    if (size != out.cap) {
+        char *buf = default_buf;
+        size_t cap = size;
+        if (size > MX_OUT_DEFAULT_SIZE) {
+            buf = (char *)MX_MALLOC(size);
+            if (buf == NULL) {
+                return -1;
+            }
+            cap = malloc_usable_size(buf);
+        }
+        if (out.buf != default_buf) {
+            MX_FREE(out.buf);
+        }
+        out.buf = buf;
+        out.cap = cap;
+    }
+    out.mode = mode;
+    return 0;
+}
+
+void mx_out_write(const void *data, size_t len) {
+    if (data == NULL || len == 0) {
+        return;
+    }
+
+    register_at_exit();
+    if (out.mode == MX_OUT_NONE) {
+        write_all(data, len, NULL, 0);
+        return;
+    }
+    if (len <= out.cap - out.len) {
+        mx_memcpy(out.buf + out.len, data, len);
+        out.len += len;
+        if (out.len == out.cap) {
+            mx_out_flush();
+        }
+    } else {
+        write_all(out.buf, out.len, data, len);
+        out.len = 0;
+        return;
+    }
+    if (out.mode == MX_OUT_LINE && mx_memchr(data, '\n', len)) {
+        mx_out_flush();
+    }
+}
+
+void mx_out_putc(char c) {
+    if (out.mode == MX_OUT_NONE || out.len == out.cap) {
+        mx_out_write(&c, 1);
+        return;
+    }
+
+    register_at_exit();
+    out.buf[out.len++] = c;
+    if (out.len == out.cap || (c == '\n' && out.mode == MX_OUT_LINE)) {
+        mx_out_flush();
+    }
+}
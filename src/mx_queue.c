@@ -0,0 +1,403 @@
+/**
+ * @file mx_queue.c
+ * @brief Lock-free multi-producer/multi-consumer queues.
+ *
+ * t_mx_ring is a bounded queue over a power-of-two array of cells. Each
+ * cell carries a sequence number that tells producers and consumers
+ * whose turn it is, so a push or pop costs one CAS on a shared index
+ * and never blocks. The two indices sit on separate cache lines.
+ *
+ * t_mx_queue is an unbounded Michael-Scott queue: a singly-linked list
+ * with a dummy head, appended with CAS on the tail's next pointer.
+ * Popped nodes are reclaimed with hazard pointers. Every thread that
+ * touches a queue owns a record holding the nodes it is reading and
+ * the nodes it has unlinked; unlinked nodes are freed once no record
+ * points at them. A record is released for reuse when its thread
+ * exits.
+ *
+ * Functions:
+ * - t_mx_ring *mx_ring_new(size_t capacity): Creates a ring of at least capacity slots.
+ * - bool mx_ring_push(t_mx_ring *ring, void *data): Pushes data, false when full.
+ * - bool mx_ring_pop(t_mx_ring *ring, void **data): Pops into data, false when empty.
+ * - void mx_ring_del(t_mx_ring **ring): Frees the ring and sets the pointer to NULL.
+ * - t_mx_queue *mx_queue_new(void): Creates an unbounded queue.
+ * - int mx_queue_push(t_mx_queue *queue, void *data): Pushes data, -1 when out of memory.
+ * - bool mx_queue_pop(t_mx_queue *queue, void **data): Pops into data, false when empty.
+ * - void mx_queue_del(t_mx_queue **queue): Frees the queue and sets the pointer to NULL.
+ */
+
+#include "../inc/libmx.h"
+#include <threads.h>
+
+#define MX_CACHE_LINE 64
+// Unlinked nodes a thread collects before it tries to free them
+#define MX_HP_RETIRE 64
+
+t_mx_ring *mx_ring_new(size_t capacity) {
+    MX_PROBE();
+    size_t size = 2;
+    while (size < capacity) {
+        if (size > SIZE_MAX / 2 / sizeof(t_mx_ring_cell)) {
+            return NULL;
+        }
+        size *= 2;
+    }
+
+    t_mx_ring *ring = (t_mx_ring *)MX_ALIGNED_ALLOC(MX_CACHE_LINE,
+                                                    sizeof(t_mx_ring));
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->cells = (t_mx_ring_cell *)MX_MALLOC(size * sizeof(t_mx_ring_cell));
+    if (ring->cells == NULL) {
+        MX_FREE(ring);
+        return NULL;
+    }
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&ring->cells[i].seq, i);
+        ring->cells[i].data = NULL;
+    }
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return ring;
+}
+
+/*
+ * A cell is free for the producer holding position pos when its
+ * sequence equals pos, and holds data for the consumer at pos when it
+ * equals pos + 1. A smaller sequence means the ring has wrapped around.
+ */
+bool mx_ring_push(t_mx_ring *ring, void *data) {
+    if (ring == NULL) {
+        return false;
+    }
+
+    size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    t_mx_ring_cell *cell;
+    while (true) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos,
+                    pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+    cell->data = data;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    return true;
+}
+
+bool mx_ring_pop(t_mx_ring *ring, void **data) {
+    if (ring == NULL) {
+        return false;
+    }
+
+    size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    t_mx_ring_cell *cell;
+    while (true) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &pos,
+                    pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+    if (data != NULL) {
+        *data = cell->data;
+    }
+    atomic_store_explicit(&cell->seq, pos + ring->mask + 1,
+                          memory_order_release);
+    return true;
+}
+
+void mx_ring_del(t_mx_ring **ring) {
+    MX_PROBE();
+    if (ring == NULL || *ring == NULL) {
+        return;
+    }
+    MX_FREE((*ring)->cells);
+    MX_FREE(*ring);
+    *ring = NULL;
+}
+
+// Hazard pointers
+
+typedef struct  s_hp_rec {
+    _Atomic(t_mx_qnode *) hp[2];
+    atomic_bool active;
+    struct s_hp_rec *next;
+    t_mx_qnode **retired;
+    size_t n_retired;
+    t_mx_qnode *overflow;
+}               t_hp_rec;
+
+static _Atomic(t_hp_rec *) hp_records = NULL;
+static _Thread_local t_hp_rec *hp_self = NULL;
+static tss_t hp_key;
+static bool hp_key_ok = false;
+
+static bool is_hazard(const t_mx_qnode *node) {
+    for (t_hp_rec *r = atomic_load(&hp_records); r != NULL; r = r->next) {
+        if (atomic_load(&r->hp[0]) == node
+            || atomic_load(&r->hp[1]) == node) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Nodes that could not be added to the retired array wait in the
+ * overflow list, linked through a field of their own: a thread that
+ * still protects a node may read its next and data fields.
+ */
+static void hp_scan(t_hp_rec *rec) {
+    size_t kept = 0;
+    for (size_t i = 0; i < rec->n_retired; i++) {
+        if (is_hazard(rec->retired[i])) {
+            rec->retired[kept++] = rec->retired[i];
+        } else {
+            MX_FREE(rec->retired[i]);
+        }
+    }
+    rec->n_retired = kept;
+
+    t_mx_qnode **link = &rec->overflow;
+    while (*link != NULL) {
+        t_mx_qnode *node = *link;
+        if (is_hazard(node)) {
+            link = &node->overflow;
+        } else {
+            *link = node->overflow;
+            MX_FREE(node);
+        }
+    }
+}
+
+// Runs at thread exit; leftover nodes stay with the record's next owner
+static void hp_release(void *arg) {
+    t_hp_rec *rec = (t_hp_rec *)arg;
+    atomic_store(&rec->hp[0], NULL);
+    atomic_store(&rec->hp[1], NULL);
+    hp_scan(rec);
+    atomic_store(&rec->active, false);
+}
+
+__attribute__((constructor))
+static void hp_key_init(void) {
+    hp_key_ok = tss_create(&hp_key, hp_release) == thrd_success;
+}
+
+/*
+ * Claims an inactive record or links a new one in front. Records are
+ * never unlinked, so scanning them needs no protection of its own.
+ */
+static t_hp_rec *hp_record(void) {
+    if (hp_self != NULL) {
+        return hp_self;
+    }
+
+    t_hp_rec *rec;
+    for (rec = atomic_load(&hp_records); rec != NULL; rec = rec->next) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&rec->active, &expected, true)) {
+            break;
+        }
+    }
+    if (rec == NULL) {
+        rec = (t_hp_rec *)MX_MALLOC(sizeof(t_hp_rec));
+        if (rec == NULL) {
+            return NULL;
+        }
+        atomic_init(&rec->hp[0], NULL);
+        atomic_init(&rec->hp[1], NULL);
+        atomic_init(&rec->active, true);
+        rec->retired = NULL;
+        rec->n_retired = 0;
+        rec->overflow = NULL;
+        rec->next = atomic_load(&hp_records);
+        while (!atomic_compare_exchange_weak(&hp_records, &rec->next, rec));
+    }
+
+    if (hp_key_ok) {
+        tss_set(hp_key, rec);
+    }
+    hp_self = rec;
+    return rec;
+}
+
+static void hp_retire(t_hp_rec *rec, t_mx_qnode *node) {
+    if (rec->n_retired == 0 || rec->n_retired % MX_HP_RETIRE == 0) {
+        void *grown = mx_realloc_grow(rec->retired, (rec->n_retired
+                                      + MX_HP_RETIRE) * sizeof(t_mx_qnode *));
+        if (grown == NULL) {
+            hp_scan(rec);
+            if (is_hazard(node)) {
+                node->overflow = rec->overflow;
+                rec->overflow = node;
+            } else {
+                MX_FREE(node);
+            }
+            return;
+        }
+        rec->retired = (t_mx_qnode **)grown;
+    }
+    rec->retired[rec->n_retired++] = node;
+    if (rec->n_retired >= MX_HP_RETIRE) {
+        hp_scan(rec);
+    }
+}
+
+// Michael-Scott queue
+
+static t_mx_qnode *qnode_new(void *data) {
+    t_mx_qnode *node = (t_mx_qnode *)MX_MALLOC(sizeof(t_mx_qnode));
+    if (node == NULL) {
+        return NULL;
+    }
+    node->data = data;
+    node->overflow = NULL;
+    atomic_init(&node->next, NULL);
+    return node;
+}
+
+t_mx_queue *mx_queue_new(void) {
+    MX_PROBE();
+    t_mx_queue *queue = (t_mx_queue *)MX_ALIGNED_ALLOC(MX_CACHE_LINE,
+                                                       sizeof(t_mx_queue));
+    if (queue == NULL) {
+        return NULL;
+    }
+    t_mx_qnode *dummy = qnode_new(NULL);
+    if (dummy == NULL) {
+        MX_FREE(queue);
+        return NULL;
+    }
+    atomic_init(&queue->head, dummy);
+    atomic_init(&queue->tail, dummy);
+    return queue;
+}
+
+int mx_queue_push(t_mx_queue *queue, void *data) {
+    MX_PROBE();
+    if (queue == NULL) {
+        return -1;
+    }
+    t_hp_rec *rec = hp_record();
+    t_mx_qnode *node = qnode_new(data);
+    if (rec == NULL || node == NULL) {
+        MX_FREE(node);
+        return -1;
+    }
+
+    while (true) {
+        t_mx_qnode *tail = atomic_load(&queue->tail);
+        atomic_store(&rec->hp[0], tail);
+        if (tail != atomic_load(&queue->tail)) {
+            continue;
+        }
+        t_mx_qnode *next = atomic_load(&tail->next);
+        if (next != NULL) {
+            // Help a producer that linked its node but not the tail yet
+            atomic_compare_exchange_strong(&queue->tail, &tail, next);
+            continue;
+        }
+        if (atomic_compare_exchange_strong(&tail->next, &next, node)) {
+            atomic_compare_exchange_strong(&queue->tail, &tail, node);
+            break;
+        }
+    }
+    atomic_store(&rec->hp[0], NULL);
+    return 0;
+}
+
+/*
+ * The head is protected before its next pointer is read, and next is
+ * protected before the head is checked again: while the head has not
+ * moved, neither node can have been retired.
+ */
+bool mx_queue_pop(t_mx_queue *queue, void **data) {
+    MX_PROBE();
+    if (queue == NULL) {
+        return false;
+    }
+    t_hp_rec *rec = hp_record();
+    if (rec == NULL) {
+        return false;
+    }
+
+    t_mx_qnode *head;
+    void *value;
+    while (true) {
+        head = atomic_load(&queue->head);
+        atomic_store(&rec->hp[0], head);
+        if (head != atomic_load(&queue->head)) {
+            continue;
+        }
+        t_mx_qnode *tail = atomic_load(&queue->tail);
+        t_mx_qnode *next = atomic_load(&head->next);
+        atomic_store(&rec->hp[1], next);
+        if (head != atomic_load(&queue->head)) {
+            continue;
+        }
+        if (next == NULL) {
+            atomic_store(&rec->hp[0], NULL);
+            atomic_store(&rec->hp[1], NULL);
+            return false;
+        }
+        if (head == tail) {
+            atomic_compare_exchange_strong(&queue->tail, &tail, next);
+            continue;
+        }
+        value = next->data;
+        if (atomic_compare_exchange_strong(&queue->head, &head, next)) {
+            break;
+        }
+    }
+    atomic_store(&rec->hp[0], NULL);
+    atomic_store(&rec->hp[1], NULL);
+    hp_retire(rec, head);
+    if (data != NULL) {
+        *data = value;
+    }
+    return true;
+}
+
+// Must not race with other operations on the same queue
+void mx_queue_del(t_mx_queue **queue) {
+    MX_PROBE();
+    if (queue == NULL || *queue == NULL) {
+        return;
+    }
+
+    t_mx_qnode *node = atomic_load(&(*queue)->head);
+    while (node != NULL) {
+        t_mx_qnode *next = atomic_load(&node->next);
+        if (is_hazard(node)) {
+            t_hp_rec *rec = hp_record();
+            if (rec != NULL) {
+                hp_retire(rec, node);
+            }
+        } else {
+            MX_FREE(node);
+        }
+        node = next;
+    }
+    MX_FREE(*queue);
+    *queue = NULL;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file mx_search.c
+ * @brief Substring search engine behind mx_strstr, mx_memmem and friends.
+ *
+ * The strategy is picked from the needle length when a needle is
+ * prepared: a single byte goes straight to mx_memchr, short needles use a
+ * vectorized first/last byte filter, and long needles use
+ * Boyer-Moore-Horspool with a 256-entry skip table. Preparing a needle
+ * once with mx_needle_init or mx_needle_new lets repeated searches skip
+ * the setup cost.
+ *
+ * Functions:
+ * - void mx_needle_init(t_mx_needle *needle, const void *bytes, size_t len): Prepares a needle that borrows bytes.
+ * - t_mx_needle *mx_needle_new(const void *bytes, size_t len): Allocates a needle that owns a copy of bytes.
+ * - void mx_needle_del(t_mx_needle **needle): Frees a needle from mx_needle_new and sets the pointer to NULL.
+ * - void *mx_needle_find(const t_mx_needle *needle, const void *hay, size_t hay_len): Finds the first match in hay.
+ */
+
+#include "../inc/libmx.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MX_HAVE_X86 1
+#endif
+
+static void *find_short_scalar(const unsigned char *h, size_t n,
+                               const unsigned char *b, size_t m) {
+    const unsigned char *end = h + n - m + 1;
+
+    while (h < end) {
+        h = mx_memchr(h, b[0], end - h);
+        if (h == NULL) {
+            return NULL;
+        }
+        if (mx_memcmp(h + 1, b + 1, m - 1) == 0) {
+            return (void *)h;
+        }
+        h++;
+    }
+    return NULL;
+}
+
+#ifdef MX_HAVE_X86
+
+/*
+ * First/last byte filter: a candidate position must match both the
+ * needle's first byte and its last byte, which rules out almost every
+ * position with two compares per vector. Survivors get a full compare.
+ */
+__attribute__((target("sse2")))
+static void *find_short_sse2(const unsigned char *h, size_t n,
+                             const unsigned char *b, size_t m) {
+    __m128i first = _mm_set1_epi8((char)b[0]);
+    __m128i last = _mm_set1_epi8((char)b[m - 1]);
+    size_t i = 0;
+
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i hf = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i hl = _mm_loadu_si128((const __m128i *)(h + i + m - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(hf, first), _mm_cmpeq_epi8(hl, last)));
+        while (mask) {
+            size_t at = i + __builtin_ctz(mask);
+            if (mx_memcmp(h + at + 1, b + 1, m - 2) == 0) {
+                return (void *)(h + at);
+            }
+            mask &= mask - 1;
+        }
+    }
+    return find_short_scalar(h + i, n - i, b, m);
+}
+
+__attribute__((target("avx2")))
+static void *find_short_avx2(const unsigned char *h, size_t n,
+                             const unsigned char *b, size_t m) {
+    __m256i first = _mm256_set1_epi8((char)b[0]);
+    __m256i last = _mm256_set1_epi8((char)b[m - 1]);
+    size_t i = 0;
+
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i hf = _mm256_loadu_si256((const __m256i *)(h + i));
+        __m256i hl = _mm256_loadu_si256((const __m256i *)(h + i + m - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(hf, first),
+                             _mm256_cmpeq_epi8(hl, last)));
+        while (mask) {
+            size_t at = i + __builtin_ctz(mask);
+            if (mx_memcmp(h + at + 1, b + 1, m - 2) == 0) {
+                return (void *)(h + at);
+            }
+            mask &= mask - 1;
+        }
+    }
+    return find_short_sse2(h + i, n - i, b, m);
+}
+
+#endif /* MX_HAVE_X86 */
+
+static void *(*find_short)(const unsigned char *, size_t,
+                           const unsigned char *, size_t) = find_short_scalar;
+
+__attribute__((constructor))
+static void search_ops_init(void) {
+#ifdef MX_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        find_short = find_short_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        find_short = find_short_sse2;
+    }
+#endif
+}
+
+static void *find_horspool(const t_mx_needle *needle,
+                           const unsigned char *h, size_t n) {
+    const unsigned char *b = needle->bytes;
+    size_t last = needle->len - 1;
+    unsigned char tail = b[last];
+
+    for (size_t i = 0; i + last < n; i += needle->shift[h[i + last]]) {
+        if (h[i + last] == tail && mx_memcmp(h + i, b, last) == 0) {
+            return (void *)(h + i);
+        }
+    }
+    return NULL;
+}
+
+void mx_needle_init(t_mx_needle *needle, const void *bytes, size_t len) {
+    if (needle == NULL) {
+        return;
+    }
+    needle->bytes = bytes;
+    needle->len = bytes ? len : 0;
+    if (needle->len <= MX_NEEDLE_SHORT) {
+        return;
+    }
+    const unsigned char *b = bytes;
+    for (int i = 0; i < 256; i++) {
+        needle->shift[i] = len;
+    }
+    for (size_t i = 0; i + 1 < len; i++) {
+        needle->shift[b[i]] = len - 1 - i;
+    }
+}
+
+t_mx_needle *mx_needle_new(const void *bytes, size_t len) {
+    MX_PROBE();
+    if (bytes == NULL && len > 0) {
+        return NULL;
+    }
+    t_mx_needle *needle = (t_mx_needle *)MX_MALLOC(sizeof(t_mx_needle) + len);
+    if (needle == NULL) {
+        return NULL;
+    }
+    unsigned char *copy = (unsigned char *)(needle + 1);
+    if (len > 0) {
+        mx_memcpy(copy, bytes, len);
+    }
+    mx_needle_init(needle, copy, len);
+    return needle;
+}
+
+void mx_needle_del(t_mx_needle **needle) {
+    MX_PROBE();
+    if (needle == NULL) {
+        return;
+    }
+    MX_FREE(*needle);
+    *needle = NULL;
+}
+
+void *mx_needle_find(const t_mx_needle *needle, const void *hay,
+                     size_t hay_len) {
+    if (needle == NULL || hay == NULL) {
+        return NULL;
+    }
+    size_t m = needle->len;
+    if (m == 0) {
+        return (void *)hay;
+    }
+    if (m > hay_len) {
+        return NULL;
+    }
+    if (m == 1) {
+        return mx_memchr(hay, needle->bytes[0], hay_len);
+    }
+    if (m <= MX_NEEDLE_SHORT) {
+        return find_short(hay, hay_len, needle->bytes, m);
+    }
+    return find_horspool(needle, hay, hay_len);
+}
@@ -0,0 +1,370 @@
+/**
+ * @file mx_sort.c
+ * @brief O(n log n) sorting engine for arrays, string arrays and lists.
+ *
+ * Arrays are sorted with introsort: median-of-three quicksort that
+ * recurses into the smaller side only, falls back to heapsort when the
+ * recursion gets too deep and finishes short ranges with insertion sort.
+ * When stability is needed mx_stable_sort merges instead, and it also
+ * reports the number of inversions it removed. That is the number of
+ * swaps an exchange sort such as mx_bubble_sort would have made. String
+ * arrays get a most-significant-digit sort on cached 8-byte key
+ * prefixes, and lists get a bottom-up merge sort that relinks nodes.
+ *
+ * Functions:
+ * - void mx_sort(void *base, size_t n, size_t size, int (*cmp)(const void *, const void *)): Sorts an array (not stable).
+ * - long mx_stable_sort(void *base, size_t n, size_t size, int (*cmp)(const void *, const void *)): Stable sort returning the inversion count.
+ * - long mx_stable_sort_ptrs(void **arr, size_t n, bool (*cmp)(void *, void *)): mx_stable_sort with an mx_sort_list style predicate.
+ * - void mx_sort_strarr(char **arr, size_t n): Sorts strings in strcmp order using cached key prefixes.
+ * - t_list *mx_list_merge_sort(t_list *lst, bool (*cmp)(void *, void *)): Stable merge sort relinking the nodes.
+ */
+
+#include "../inc/libmx.h"
+
+// Ranges up to this many elements are finished with insertion sort
+#define MX_SORT_SMALL 16
+
+typedef size_t __attribute__((__may_alias__, __aligned__(1))) t_mx_uword;
+
+/*
+ * Ordering used by the merge routines. Array callers provide a
+ * three-way comparator over element addresses; list callers provide the
+ * mx_sort_list style predicate over data pointers, true when a must go
+ * after b.
+ */
+typedef struct  s_order {
+    int (*cmp)(const void *, const void *);
+    bool (*after)(void *, void *);
+}               t_order;
+
+static bool greater(const t_order *o, const void *a, const void *b) {
+    if (o->cmp) {
+        return o->cmp(a, b) > 0;
+    }
+    return o->after(*(void *const *)a, *(void *const *)b);
+}
+
+static void swap_elems(char *a, char *b, size_t size) {
+    if (size == sizeof(size_t)) {
+        size_t t = *(t_mx_uword *)a;
+        *(t_mx_uword *)a = *(t_mx_uword *)b;
+        *(t_mx_uword *)b = t;
+        return;
+    }
+    while (size--) {
+        char t = *a;
+        *a++ = *b;
+        *b++ = t;
+    }
+}
+
+static void insertion_sort(char *base, size_t n, size_t size,
+                           int (*cmp)(const void *, const void *)) {
+    for (size_t i = 1; i < n; i++) {
+        for (size_t j = i; j > 0; j--) {
+            char *cur = base + j * size;
+            if (cmp(cur - size, cur) <= 0) {
+                break;
+            }
+            swap_elems(cur - size, cur, size);
+        }
+    }
+}
+
+static void sift_down(char *base, size_t root, size_t n, size_t size,
+                      int (*cmp)(const void *, const void *)) {
+    size_t child;
+
+    while ((child = 2 * root + 1) < n) {
+        if (child + 1 < n
+            && cmp(base + child * size, base + (child + 1) * size) < 0) {
+            child++;
+        }
+        if (cmp(base + root * size, base + child * size) >= 0) {
+            return;
+        }
+        swap_elems(base + root * size, base + child * size, size);
+        root = child;
+    }
+}
+
+static void heap_sort(char *base, size_t n, size_t size,
+                      int (*cmp)(const void *, const void *)) {
+    for (size_t i = n / 2; i > 0; i--) {
+        sift_down(base, i - 1, n, size, cmp);
+    }
+    for (size_t end = n - 1; end > 0; end--) {
+        swap_elems(base, base + end * size, size);
+        sift_down(base, 0, end, size, cmp);
+    }
+}
+
+static void intro_sort(char *base, size_t n, size_t size,
+                       int (*cmp)(const void *, const void *), int depth) {
+    while (n > MX_SORT_SMALL) {
+        if (depth-- == 0) {
+            heap_sort(base, n, size, cmp);
+            return;
+        }
+
+        char *lo = base;
+        char *mid = base + (n / 2) * size;
+        char *hi = base + (n - 1) * size;
+        if (cmp(mid, lo) < 0) swap_elems(mid, lo, size);
+        if (cmp(hi, mid) < 0) swap_elems(hi, mid, size);
+        if (cmp(mid, lo) < 0) swap_elems(mid, lo, size);
+        swap_elems(lo, mid, size);
+
+        // Hoare partition around the pivot now sitting at lo
+        size_t i = 0;
+        size_t j = n;
+        while (true) {
+            do i++; while (i < n && cmp(base + i * size, lo) < 0);
+            do j--; while (cmp(base + j * size, lo) > 0);
+            if (i >= j) {
+                break;
+            }
+            swap_elems(base + i * size, base + j * size, size);
+        }
+        swap_elems(lo, base + j * size, size);
+
+        size_t left = j;
+        size_t right = n - j - 1;
+        if (left < right) {
+            intro_sort(base, left, size, cmp, depth);
+            base += (j + 1) * size;
+            n = right;
+        } else {
+            intro_sort(base + (j + 1) * size, right, size, cmp, depth);
+            n = left;
+        }
+    }
+    insertion_sort(base, n, size, cmp);
+}
+
+void mx_sort(void *base, size_t n, size_t size,
+             int (*cmp)(const void *, const void *)) {
+    if (base == NULL || cmp == NULL || size == 0 || n < 2) {
+        return;
+    }
+
+    int depth = 0;
+    for (size_t k = n; k > 1; k >>= 1) {
+        depth += 2;
+    }
+    intro_sort(base, n, size, cmp, depth);
+}
+
+/*
+ * Top-down merge sort through tmp. Every element taken from the right
+ * run jumps over all the elements still pending in the left run, which
+ * is exactly the number of inversions it resolves.
+ */
+static long merge_sort(char *base, char *tmp, size_t n, size_t size,
+                       const t_order *o) {
+    long inv = 0;
+
+    if (n <= MX_SORT_SMALL) {
+        for (size_t i = 1; i < n; i++) {
+            for (size_t j = i; j > 0; j--) {
+                char *cur = base + j * size;
+                if (!greater(o, cur - size, cur)) {
+                    break;
+                }
+                swap_elems(cur - size, cur, size);
+                inv++;
+            }
+        }
+        return inv;
+    }
+
+    size_t mid = n / 2;
+    inv += merge_sort(base, tmp, mid, size, o);
+    inv += merge_sort(base + mid * size, tmp, n - mid, size, o);
+    if (!greater(o, base + (mid - 1) * size, base + mid * size)) {
+        return inv;
+    }
+
+    size_t i = 0;
+    size_t j = mid;
+    size_t k = 0;
+    while (i < mid && j < n) {
+        if (greater(o, base + i * size, base + j * size)) {
+            mx_memcpy(tmp + k++ * size, base + j++ * size, size);
+            inv += mid - i;
+        } else {
+            mx_memcpy(tmp + k++ * size, base + i++ * size, size);
+        }
+    }
+    mx_memcpy(tmp + k * size, base + i * size, (mid - i) * size);
+    k += mid - i;
+    mx_memcpy(base, tmp, k * size);
+    return inv;
+}
+
+static long stable_sort(void *base, size_t n, size_t size, const t_order *o) {
+    if (n < 2) {
+        return 0;
+    }
+
+    char *tmp = (char *)MX_MALLOC(n * size);
+    if (tmp == NULL) {
+        return -1;
+    }
+    long inv = merge_sort(base, tmp, n, size, o);
+    MX_FREE(tmp);
+    return inv;
+}
+
+long mx_stable_sort(void *base, size_t n, size_t size,
+                    int (*cmp)(const void *, const void *)) {
+    MX_PROBE();
+    if (base == NULL || cmp == NULL || size == 0) {
+        return -1;
+    }
+
+    t_order o = {cmp, NULL};
+    return stable_sort(base, n, size, &o);
+}
+
+long mx_stable_sort_ptrs(void **arr, size_t n, bool (*cmp)(void *, void *)) {
+    MX_PROBE();
+    if (arr == NULL || cmp == NULL) {
+        return -1;
+    }
+
+    t_order o = {NULL, cmp};
+    return stable_sort(arr, n, sizeof(void *), &o);
+}
+
+typedef struct  s_skey {
+    uint64_t key;
+    char *s;
+}               t_skey;
+
+static int cmp_skey(const void *a, const void *b) {
+    uint64_t ka = ((const t_skey *)a)->key;
+    uint64_t kb = ((const t_skey *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+static int cmp_str(const void *a, const void *b) {
+    const unsigned char *s1 = *(const unsigned char *const *)a;
+    const unsigned char *s2 = *(const unsigned char *const *)b;
+    while (*s1 && *s1 == *s2) {
+        s1++;
+        s2++;
+    }
+    return *s1 - *s2;
+}
+
+// Packs the 8 bytes at depth big-endian, zero-padded after the '\0'
+static uint64_t prefix_key(const char *s, size_t depth) {
+    uint64_t key = 0;
+    int i = 0;
+
+    for (s += depth; i < 8 && s[i]; i++) {
+        key = (key << 8) | (unsigned char)s[i];
+    }
+    return i == 0 ? 0 : key << (8 * (8 - i));
+}
+
+/*
+ * Sorts on integer keys, then refines every run of equal keys on the
+ * next 8 bytes. A run whose key ends in a zero byte holds strings that
+ * all ended inside this prefix, so they are equal and need no more work.
+ */
+static void msd_sort(t_skey *a, size_t n, size_t depth) {
+    for (size_t i = 0; i < n; i++) {
+        a[i].key = prefix_key(a[i].s, depth);
+    }
+    mx_sort(a, n, sizeof(t_skey), cmp_skey);
+
+    for (size_t start = 0; start < n;) {
+        size_t end = start + 1;
+        while (end < n && a[end].key == a[start].key) {
+            end++;
+        }
+        if (end - start > 1 && (a[start].key & 0xFF) != 0) {
+            msd_sort(a + start, end - start, depth + 8);
+        }
+        start = end;
+    }
+}
+
+void mx_sort_strarr(char **arr, size_t n) {
+    MX_PROBE();
+    if (arr == NULL || n < 2) {
+        return;
+    }
+
+    t_skey *keys = (t_skey *)MX_MALLOC(n * sizeof(t_skey));
+    if (keys == NULL) {
+        mx_sort(arr, n, sizeof(char *), cmp_str);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        keys[i].s = arr[i];
+    }
+    msd_sort(keys, n, 0);
+    for (size_t i = 0; i < n; i++) {
+        arr[i] = keys[i].s;
+    }
+    MX_FREE(keys);
+}
+
+/*
+ * Bottom-up: runs of width 1, 2, 4, ... are merged pairwise by relinking
+ * nodes, so no memory is allocated and no recursion is needed. Ties keep
+ * their original order.
+ */
+t_list *mx_list_merge_sort(t_list *lst, bool (*cmp)(void *, void *)) {
+    if (lst == NULL || cmp == NULL) {
+        return lst;
+    }
+
+    for (size_t width = 1;; width *= 2) {
+        t_list *rest = lst;
+        t_list head = {NULL, NULL};
+        t_list *tail = &head;
+        size_t merges = 0;
+
+        while (rest != NULL) {
+            t_list *left = rest;
+            t_list *right = rest;
+            size_t left_len = 0;
+            while (right != NULL && left_len < width) {
+                right = right->next;
+                left_len++;
+            }
+            size_t right_len = width;
+            merges++;
+
+            while (left_len > 0 || (right_len > 0 && right != NULL)) {
+                t_list *take;
+                if (left_len == 0) {
+                    take = right;
+                    right = right->next;
+                    right_len--;
+                } else if (right_len == 0 || right == NULL
+                           || !cmp(left->data, right->data)) {
+                    take = left;
+                    left = left->next;
+                    left_len--;
+                } else {
+                    take = right;
+                    right = right->next;
+                    right_len--;
+                }
+                tail->next = take;
+                tail = take;
+            }
+            rest = right;
+        }
+        tail->next = NULL;
+        lst = head.next;
+        if (merges <= 1) {
+            return lst;
+        }
+    }
+}
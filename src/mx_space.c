@@ -0,0 +1,395 @@
+/**
+ * @file mx_space.c
+ * @brief Whitespace classification, in-place trimming and streaming
+ *        whitespace normalization.
+ *
+ * Whitespace is ' ', '\n', '\t' and '\f', as it always was for
+ * mx_strtrim and mx_del_extra_spaces. Everything works on explicit
+ * lengths, so no function rescans for the terminating '\0'.
+ *
+ * The kernels classify a whole block at once: with AVX2 a single byte
+ * shuffle on the low nibble and a compare turn 32 bytes into a bit
+ * mask, since the four whitespace bytes all have different low nibbles.
+ * SSE2 compares 16 bytes against each of the four. Normalizing drops
+ * every whitespace byte that follows another one; with AVX2 the mask
+ * of kept bytes drives a shuffle that packs 8 bytes at once, and a
+ * block without any whitespace is copied as is.
+ *
+ * Normalization keeps its state in a t_mx_space_norm, so a text split
+ * into chunks at arbitrary points comes out exactly as
+ * mx_del_extra_spaces would produce it from the whole text. out must
+ * hold len + 1 bytes: whitespace pending from the previous chunk is
+ * written as a space before a chunk that starts with a word. The first
+ * chunk of a text never needs more than len.
+ *
+ * Functions:
+ * - bool mx_isspace(char c): Whether c is whitespace.
+ * - size_t mx_space_span(const char *s, size_t len): Length of the whitespace run at the start of s.
+ * - size_t mx_word_span(const char *s, size_t len): Length of the non-whitespace run at the start of s.
+ * - size_t mx_strtrim_inplace(char *s, size_t len): mx_strtrim in place, returns the new length.
+ * - size_t mx_del_extra_spaces_inplace(char *s, size_t len): mx_del_extra_spaces in place, returns the new length.
+ * - void mx_space_norm_init(t_mx_space_norm *st): Starts a new normalized text.
+ * - size_t mx_space_norm(t_mx_space_norm *st, const char *in, size_t len, char *out): Normalizes the next chunk into out, which holds len + 1 bytes.
+ */
+
+#include "../inc/libmx.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MX_HAVE_X86 1
+#endif
+
+static inline bool is_space(unsigned char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\f';
+}
+
+/*
+ * Normalization keeps a byte unless it is whitespace right after
+ * whitespace, and writes kept whitespace as ' '. Every byte is stored
+ * and only the output position depends on the class, so there is no
+ * branch to mispredict on short words. prev carries whether the byte
+ * before in was whitespace. Each byte is read before anything is
+ * stored, so out may be in itself as long as it does not run ahead.
+ */
+static inline size_t squeeze_bytes(const unsigned char *in, size_t n,
+                                   unsigned char *out, bool *prev) {
+    size_t j = 0;
+    bool sp_prev = *prev;
+
+    for (size_t k = 0; k < n; k++) {
+        unsigned char c = in[k];
+        bool sp = is_space(c);
+        out[j] = sp ? ' ' : c;
+        j += !(sp && sp_prev);
+        sp_prev = sp;
+    }
+    *prev = sp_prev;
+    return j;
+}
+
+// Same with the whitespace bytes given as the set bits of mask
+static inline size_t squeeze_bits(const unsigned char *in, size_t n,
+                                  unsigned mask, unsigned char *out,
+                                  bool *prev) {
+    size_t j = 0;
+    unsigned sp_prev = *prev;
+
+    for (size_t k = 0; k < n; k++, mask >>= 1) {
+        unsigned char c = in[k];
+        unsigned sp = mask & 1;
+        out[j] = sp ? ' ' : c;
+        j += !(sp & sp_prev);
+        sp_prev = sp;
+    }
+    *prev = sp_prev;
+    return j;
+}
+
+/*
+ * Leading whitespace is skipped first. Whitespace pending from the last
+ * chunk becomes a space once a word follows, and trailing whitespace
+ * leaves exactly one space at the end of the output, which is taken
+ * back and remembered as pending instead.
+ */
+static inline size_t squeeze_with(t_mx_space_norm *st,
+                                  const unsigned char *in, size_t len,
+                                  unsigned char *out,
+                                  size_t (*span)(const unsigned char *,
+                                                 size_t, bool),
+                                  size_t (*body)(const unsigned char *,
+                                                 size_t, unsigned char *,
+                                                 bool *)) {
+    size_t i = span(in, len, true);
+    size_t j = 0;
+    bool prev = true;
+
+    st->gap = st->gap || i > 0;
+    if (i == len) {
+        return 0;
+    }
+    if (st->gap && st->words) {
+        out[j++] = ' ';
+    }
+    j += body(in + i, len - i, out + j, &prev);
+    st->words = true;
+    st->gap = prev;
+    return j - prev;
+}
+
+// Kernels: leading run of one class, normalization of a buffer
+
+static size_t span_word(const unsigned char *s, size_t len, bool space) {
+    size_t i = 0;
+
+    while (i < len && is_space(s[i]) == space) {
+        i++;
+    }
+    return i;
+}
+
+static size_t body_word(const unsigned char *in, size_t len,
+                        unsigned char *out, bool *prev) {
+    return squeeze_bytes(in, len, out, prev);
+}
+
+static size_t squeeze_word(t_mx_space_norm *st, const unsigned char *in,
+                           size_t len, unsigned char *out) {
+    return squeeze_with(st, in, len, out, span_word, body_word);
+}
+
+#ifdef MX_HAVE_X86
+
+__attribute__((target("sse2")))
+static inline unsigned mask_sse2(__m128i v) {
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\f'))));
+    return (unsigned)_mm_movemask_epi8(m);
+}
+
+__attribute__((target("sse2")))
+static size_t span_sse2(const unsigned char *s, size_t len, bool space) {
+    unsigned flip = space ? 0xFFFF : 0;
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        unsigned other = mask_sse2(_mm_loadu_si128((const __m128i *)(s + i)))
+                         ^ flip;
+        if (other) {
+            return i + __builtin_ctz(other);
+        }
+    }
+    return i + span_word(s + i, len - i, space);
+}
+
+__attribute__((target("sse2")))
+static size_t body_sse2(const unsigned char *in, size_t len,
+                        unsigned char *out, bool *prev) {
+    size_t j = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        unsigned mask = mask_sse2(v);
+        if (mask == 0) {
+            _mm_storeu_si128((__m128i *)(out + j), v);
+            *prev = false;
+            j += 16;
+        } else {
+            j += squeeze_bits(in + i, 16, mask, out + j, prev);
+        }
+    }
+    return j + squeeze_bytes(in + i, len - i, out + j, prev);
+}
+
+__attribute__((target("sse2")))
+static size_t squeeze_sse2(t_mx_space_norm *st, const unsigned char *in,
+                           size_t len, unsigned char *out) {
+    return squeeze_with(st, in, len, out, span_sse2, body_sse2);
+}
+
+// The whitespace byte with the same low nibble, or one that can never match
+static const unsigned char space_tab[16] = {
+    ' ', 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, '\t', '\n', 0xFF, '\f', 0xFF, 0xFF, 0xFF
+};
+
+// Shuffle indices moving the set bits' bytes of 8 to the front
+static unsigned char pack_tab[256][8];
+
+// Bytes with the high bit set shuffle to 0, which matches none of them
+__attribute__((target("avx2")))
+static inline __m256i space_avx2(__m256i v) {
+    __m256i tab = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)space_tab));
+    return _mm256_cmpeq_epi8(_mm256_shuffle_epi8(tab, v), v);
+}
+
+__attribute__((target("avx2")))
+static size_t span_avx2(const unsigned char *s, size_t len, bool space) {
+    unsigned flip = space ? 0xFFFFFFFFu : 0;
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        unsigned other = (unsigned)_mm256_movemask_epi8(space_avx2(
+            _mm256_loadu_si256((const __m256i *)(s + i)))) ^ flip;
+        if (other) {
+            return i + __builtin_ctz(other);
+        }
+    }
+    return i + span_word(s + i, len - i, space);
+}
+
+/*
+ * The keep mask of a block is ~(space & space shifted by one byte).
+ * Each 8-byte quarter is then left-packed with one shuffle through
+ * pack_tab and stored whole; the next store starts where the kept
+ * bytes end. No store reaches past the block just read.
+ */
+__attribute__((target("avx2")))
+static size_t body_avx2(const unsigned char *in, size_t len,
+                        unsigned char *out, bool *prev) {
+    unsigned carry = *prev;
+    size_t j = 0;
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i sp = space_avx2(v);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(sp);
+        unsigned keep = ~(mask & (mask << 1 | carry));
+        __m256i w = _mm256_blendv_epi8(v, _mm256_set1_epi8(' '), sp);
+        carry = mask >> 31;
+        if (keep == 0xFFFFFFFFu) {
+            _mm256_storeu_si256((__m256i *)(out + j), w);
+            j += 32;
+            continue;
+        }
+
+        __m128i half = _mm256_castsi256_si128(w);
+        for (int q = 0; q < 4; q++, keep >>= 8) {
+            if (q == 2) {
+                half = _mm256_extracti128_si256(w, 1);
+            }
+            __m128i idx = _mm_loadl_epi64((const __m128i *)pack_tab[keep
+                                                                   & 0xFF]);
+            if (q & 1) {
+                idx = _mm_add_epi8(idx, _mm_set1_epi8(8));
+            }
+            _mm_storel_epi64((__m128i *)(out + j),
+                             _mm_shuffle_epi8(half, idx));
+            j += __builtin_popcount(keep & 0xFF);
+        }
+    }
+    *prev = carry;
+    return j + squeeze_bytes(in + i, len - i, out + j, prev);
+}
+
+__attribute__((target("avx2")))
+static size_t squeeze_avx2(t_mx_space_norm *st, const unsigned char *in,
+                           size_t len, unsigned char *out) {
+    return squeeze_with(st, in, len, out, span_avx2, body_avx2);
+}
+
+static void pack_tab_init(void) {
+    for (int k = 0; k < 256; k++) {
+        int n = 0;
+        for (int b = 0; b < 8; b++) {
+            if (k >> b & 1) {
+                pack_tab[k][n++] = (unsigned char)b;
+            }
+        }
+        while (n < 8) {
+            pack_tab[k][n++] = 0x80;
+        }
+    }
+}
+
+#endif /* MX_HAVE_X86 */
+
+// Kernel table, upgraded from CPUID at load time like mx_memory.c's
+static struct {
+    size_t (*span)(const unsigned char *, size_t, bool);
+    size_t (*squeeze)(t_mx_space_norm *, const unsigned char *, size_t,
+                      unsigned char *);
+} space_ops = {span_word, squeeze_word};
+
+__attribute__((constructor))
+static void space_ops_init(void) {
+#ifdef MX_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        pack_tab_init();
+        space_ops.span = span_avx2;
+        space_ops.squeeze = squeeze_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        space_ops.span = span_sse2;
+        space_ops.squeeze = squeeze_sse2;
+    }
+#endif
+}
+
+bool mx_isspace(char c) {
+    return is_space((unsigned char)c);
+}
+
+size_t mx_space_span(const char *s, size_t len) {
+    if (s == NULL) {
+        return 0;
+    }
+    return space_ops.span((const unsigned char *)s, len, true);
+}
+
+size_t mx_word_span(const char *s, size_t len) {
+    if (s == NULL) {
+        return 0;
+    }
+    return space_ops.span((const unsigned char *)s, len, false);
+}
+
+size_t mx_strtrim_inplace(char *s, size_t len) {
+    MX_PROBE();
+    MX_PROBE_BYTES(len);
+    if (s == NULL) {
+        return 0;
+    }
+
+    size_t start = mx_space_span(s, len);
+    size_t end = len;
+    while (end > start && is_space((unsigned char)s[end - 1])) {
+        end--;
+    }
+    if (start > 0) {
+        mx_memmove(s, s + start, end - start);
+    }
+    if (end - start < len) {
+        s[end - start] = '\0';
+    }
+    return end - start;
+}
+
+/*
+ * A fresh state never puts a space before the first word, so every
+ * space written replaces at least one whitespace byte already read and
+ * the output never overtakes the input.
+ */
+size_t mx_del_extra_spaces_inplace(char *s, size_t len) {
+    MX_PROBE();
+    MX_PROBE_BYTES(len);
+    if (s == NULL) {
+        return 0;
+    }
+
+    t_mx_space_norm st;
+    mx_space_norm_init(&st);
+    size_t n = space_ops.squeeze(&st, (const unsigned char *)s, len,
+                                 (unsigned char *)s);
+    if (n < len) {
+        s[n] = '\0';
+    }
+    return n;
+}
+
+void mx_space_norm_init(t_mx_space_norm *st) {
+    st->gap = false;
+    st->words = false;
+}
+
+/*
+ * Whitespace at the end of a chunk is only remembered: it turns into a
+ * space once the next chunk starts with a word, and is dropped if the
+ * text ends there.
+ */
+size_t mx_space_norm(t_mx_space_norm *st, const char *in, size_t len,
+                     char *out) {
+    MX_PROBE();
+    MX_PROBE_BYTES(len);
+    if (st == NULL || in == NULL || out == NULL) {
+        return 0;
+    }
+
+    return space_ops.squeeze(st, (const unsigned char *)in, len,
+                             (unsigned char *)out);
+}
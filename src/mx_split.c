@@ -0,0 +1,187 @@
+/**
+ * @file mx_split.c
+ * @brief Zero-copy splitting into (offset, length) slices.
+ *
+ * A t_mx_split_iter walks the fields of a buffer without allocating or
+ * copying anything. The delimiter is a single character, a
+ * multi-character sequence or a set of characters. Single characters
+ * are found with mx_memchr, sequences with the search engine's
+ * precompiled needles, and small sets with an SSE2 compare-and-merge
+ * scan where available. Empty fields are skipped like in mx_strsplit
+ * unless MX_SPLIT_KEEP_EMPTY is given.
+ *
+ * Functions:
+ * - void mx_split_init(t_mx_split_iter *it, const char *s, size_t len, char c, int flags): Splits on one character.
+ * - void mx_split_init_seq(t_mx_split_iter *it, const char *s, size_t len, const char *delim, int flags): Splits on a character sequence.
+ * - void mx_split_init_set(t_mx_split_iter *it, const char *s, size_t len, const char *chars, int flags): Splits on any of a set of characters.
+ * - bool mx_split_next(t_mx_split_iter *it, t_mx_slice *slice): Yields the next field.
+ * - size_t mx_split_fill(t_mx_split_iter *it, t_mx_slice *out, size_t max): Fills a caller-provided array with fields.
+ * - size_t mx_split_slices(const char *s, char c, t_mx_slice *out, size_t max): Splits a C string on c into out.
+ */
+
+#include "../inc/libmx.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+enum {
+    SPLIT_CHAR,
+    SPLIT_SEQ,
+    SPLIT_SET
+};
+
+static void split_init(t_mx_split_iter *it, const char *s, size_t len,
+                       int mode, int flags) {
+    it->s = s;
+    it->len = s ? len : 0;
+    it->pos = 0;
+    it->mode = mode;
+    it->flags = flags;
+    it->done = s == NULL;
+}
+
+void mx_split_init(t_mx_split_iter *it, const char *s, size_t len, char c,
+                   int flags) {
+    if (it == NULL) {
+        return;
+    }
+
+    split_init(it, s, len, SPLIT_CHAR, flags);
+    it->set_chars[0] = c;
+    it->set_len = 1;
+}
+
+void mx_split_init_seq(t_mx_split_iter *it, const char *s, size_t len,
+                       const char *delim, int flags) {
+    if (it == NULL) {
+        return;
+    }
+
+    split_init(it, s, len, SPLIT_SEQ, flags);
+    size_t dlen = delim ? (size_t)mx_strlen(delim) : 0;
+    if (dlen == 0) {
+        // Nothing to split on: the whole buffer is one field
+        it->mode = SPLIT_CHAR;
+        it->set_len = 0;
+        return;
+    }
+    mx_needle_init(&it->needle, delim, dlen);
+}
+
+void mx_split_init_set(t_mx_split_iter *it, const char *s, size_t len,
+                       const char *chars, int flags) {
+    if (it == NULL) {
+        return;
+    }
+
+    split_init(it, s, len, SPLIT_SET, flags);
+    mx_memset(it->in_set, 0, sizeof(it->in_set));
+    it->set_len = 0;
+    for (size_t i = 0; chars && chars[i]; i++) {
+        unsigned char c = (unsigned char)chars[i];
+        if (!it->in_set[c]) {
+            it->in_set[c] = true;
+            if (it->set_len < MX_SPLIT_SET_FAST) {
+                it->set_chars[it->set_len] = chars[i];
+            }
+            it->set_len++;
+        }
+    }
+}
+
+static const char *find_set(const t_mx_split_iter *it, const char *p,
+                            const char *end) {
+#ifdef __SSE2__
+    if (it->set_len <= MX_SPLIT_SET_FAST) {
+        __m128i v[MX_SPLIT_SET_FAST];
+        for (size_t k = 0; k < it->set_len; k++) {
+            v[k] = _mm_set1_epi8(it->set_chars[k]);
+        }
+        for (; end - p >= 16; p += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i *)p);
+            __m128i hit = _mm_setzero_si128();
+            for (size_t k = 0; k < it->set_len; k++) {
+                hit = _mm_or_si128(hit, _mm_cmpeq_epi8(x, v[k]));
+            }
+            unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+            if (mask) {
+                return p + __builtin_ctz(mask);
+            }
+        }
+    }
+#endif
+    for (; p < end; p++) {
+        if (it->in_set[(unsigned char)*p]) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Finds the next delimiter at or after p and stores its length in
+ * *dlen. Returns NULL when there is none.
+ */
+static const char *find_delim(const t_mx_split_iter *it, const char *p,
+                              size_t *dlen) {
+    const char *end = it->s + it->len;
+
+    *dlen = 1;
+    switch (it->mode) {
+    case SPLIT_SEQ:
+        *dlen = it->needle.len;
+        return mx_needle_find(&it->needle, p, end - p);
+    case SPLIT_SET:
+        return find_set(it, p, end);
+    default:
+        return it->set_len ? mx_memchr(p, it->set_chars[0], end - p) : NULL;
+    }
+}
+
+bool mx_split_next(t_mx_split_iter *it, t_mx_slice *slice) {
+    if (it == NULL || slice == NULL) {
+        return false;
+    }
+
+    while (!it->done) {
+        const char *start = it->s + it->pos;
+        size_t dlen;
+        const char *stop = find_delim(it, start, &dlen);
+        size_t field;
+
+        if (stop == NULL) {
+            field = it->len - it->pos;
+            it->done = true;
+        } else {
+            field = stop - start;
+        }
+        slice->offset = it->pos;
+        slice->len = field;
+        it->pos += field + (stop ? dlen : 0);
+
+        if (field > 0 || (it->flags & MX_SPLIT_KEEP_EMPTY)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t mx_split_fill(t_mx_split_iter *it, t_mx_slice *out, size_t max) {
+    size_t n = 0;
+
+    while (n < max && mx_split_next(it, &out[n])) {
+        n++;
+    }
+    return n;
+}
+
+size_t mx_split_slices(const char *s, char c, t_mx_slice *out, size_t max) {
+    if (s == NULL || out == NULL) {
+        return 0;
+    }
+
+    t_mx_split_iter it;
+    mx_split_init(&it, s, mx_strlen(s), c, 0);
+    return mx_split_fill(&it, out, max);
+}
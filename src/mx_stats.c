@@ -0,0 +1,208 @@
+/**
+ * @file mx_stats.c
+ * @brief Optional call, byte, cycle and heap accounting for libmx.
+ *
+ * An instrumented function starts with MX_PROBE(), which declares a
+ * static t_mx_stat_site named after the function and times the call
+ * until the function returns. A site links itself into a global list
+ * the first time it runs, so a snapshot only lists functions that were
+ * actually called. Cycles are inclusive: time spent in nested libmx
+ * calls is counted by the caller too.
+ *
+ * Allocations made through MX_MALLOC and frees through MX_FREE are
+ * charged to the innermost probe running on the calling thread, or to
+ * "(other)" outside of any probe. Live bytes only drop for memory that
+ * libmx itself frees (mx_strdel, mx_del_strarr, mx_pop_front, ...), so
+ * blocks the caller hands to free stay live in the totals.
+ *
+ * Counters are relaxed atomics. A snapshot taken while other threads
+ * run is exact per counter, not across counters.
+ *
+ * Without MX_INSTRUMENT none of the probes exist, the functions below
+ * are never called by libmx and a snapshot reports no functions.
+ *
+ * Functions:
+ * - bool mx_stats_enabled(void): Tells whether libmx was built with MX_INSTRUMENT.
+ * - size_t mx_stats_snapshot(t_mx_stat *funcs, size_t max, t_mx_alloc_stats *alloc): Copies up to max function counters and the heap totals, returns the number of functions.
+ * - void mx_stats_reset(void): Zeroes every counter; live bytes are kept and the peak restarts from them.
+ * - t_mx_probe mx_probe_begin(t_mx_stat_site *site): Starts timing a call, used by MX_PROBE.
+ * - void mx_probe_end(t_mx_probe *probe): Stops timing a call, run when the probe goes out of scope.
+ * - void *mx_stat_malloc(size_t size): malloc charged to the current probe.
+ * - void *mx_stat_aligned_alloc(size_t align, size_t size): aligned_alloc charged to the current probe.
+ * - void mx_stat_free(void *ptr): free charged to the current probe.
+ */
+
+#include "../inc/libmx.h"
+#include <time.h>
+
+static t_mx_stat_site other_site = {.name = "(other)"};
+static _Atomic(t_mx_stat_site *) sites = NULL;
+static atomic_uint_least64_t total_allocs;
+static atomic_uint_least64_t total_frees;
+static atomic_int_least64_t live_bytes;
+static atomic_int_least64_t peak_bytes;
+static _Thread_local t_mx_stat_site *probe_cur = NULL;
+
+#define MX_ADD(counter, n) \
+    atomic_fetch_add_explicit(&(counter), (n), memory_order_relaxed)
+
+// TSC cycles on x86, nanoseconds elsewhere
+static uint64_t ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void site_link(t_mx_stat_site *site) {
+    bool expected = false;
+
+    if (!atomic_compare_exchange_strong(&site->linked, &expected, true)) {
+        return;
+    }
+    t_mx_stat_site *head = atomic_load_explicit(&sites, memory_order_relaxed);
+    do {
+        site->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&sites, &head, site,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static t_mx_stat_site *charged_site(void) {
+    t_mx_stat_site *site = probe_cur ? probe_cur : &other_site;
+
+    if (!atomic_load_explicit(&site->linked, memory_order_relaxed)) {
+        site_link(site);
+    }
+    return site;
+}
+
+static void live_add(int64_t delta) {
+    int64_t live = MX_ADD(live_bytes, delta) + delta;
+    int64_t peak = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+
+    while (live > peak
+           && !atomic_compare_exchange_weak_explicit(&peak_bytes, &peak, live,
+                                                     memory_order_relaxed,
+                                                     memory_order_relaxed)) {
+    }
+}
+
+static void *charge_alloc(void *ptr) {
+    if (ptr == NULL) {
+        return NULL;
+    }
+
+    size_t size = malloc_usable_size(ptr);
+    t_mx_stat_site *site = charged_site();
+    MX_ADD(site->allocs, 1);
+    MX_ADD(site->alloc_bytes, size);
+    MX_ADD(total_allocs, 1);
+    live_add((int64_t)size);
+    return ptr;
+}
+
+bool mx_stats_enabled(void) {
+#ifdef MX_INSTRUMENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t mx_stats_snapshot(t_mx_stat *funcs, size_t max,
+                         t_mx_alloc_stats *alloc) {
+    size_t n = 0;
+
+    for (t_mx_stat_site *s = atomic_load_explicit(&sites, memory_order_acquire);
+         s != NULL; s = s->next, n++) {
+        if (funcs == NULL || n >= max) {
+            continue;
+        }
+        funcs[n].name = s->name;
+        funcs[n].calls = atomic_load_explicit(&s->calls, memory_order_relaxed);
+        funcs[n].bytes = atomic_load_explicit(&s->bytes, memory_order_relaxed);
+        funcs[n].cycles = atomic_load_explicit(&s->cycles,
+                                               memory_order_relaxed);
+        funcs[n].allocs = atomic_load_explicit(&s->allocs,
+                                               memory_order_relaxed);
+        funcs[n].frees = atomic_load_explicit(&s->frees, memory_order_relaxed);
+        funcs[n].alloc_bytes = atomic_load_explicit(&s->alloc_bytes,
+                                                    memory_order_relaxed);
+        funcs[n].free_bytes = atomic_load_explicit(&s->free_bytes,
+                                                   memory_order_relaxed);
+    }
+    if (alloc != NULL) {
+        alloc->allocs = atomic_load_explicit(&total_allocs,
+                                             memory_order_relaxed);
+        alloc->frees = atomic_load_explicit(&total_frees, memory_order_relaxed);
+        alloc->live_bytes = atomic_load_explicit(&live_bytes,
+                                                 memory_order_relaxed);
+        alloc->peak_bytes = atomic_load_explicit(&peak_bytes,
+                                                 memory_order_relaxed);
+    }
+    return n;
+}
+
+void mx_stats_reset(void) {
+    for (t_mx_stat_site *s = atomic_load_explicit(&sites, memory_order_acquire);
+         s != NULL; s = s->next) {
+        atomic_store_explicit(&s->calls, 0, memory_order_relaxed);
+        atomic_store_explicit(&s->bytes, 0, memory_order_relaxed);
+        atomic_store_explicit(&s->cycles, 0, memory_order_relaxed);
+        atomic_store_explicit(&s->allocs, 0, memory_order_relaxed);
+        atomic_store_explicit(&s->frees, 0, memory_order_relaxed);
+        atomic_store_explicit(&s->alloc_bytes, 0, memory_order_relaxed);
+        atomic_store_explicit(&s->free_bytes, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&total_allocs, 0, memory_order_relaxed);
+    atomic_store_explicit(&total_frees, 0, memory_order_relaxed);
+    atomic_store_explicit(&peak_bytes,
+                          atomic_load_explicit(&live_bytes,
+                                               memory_order_relaxed),
+                          memory_order_relaxed);
+}
+
+t_mx_probe mx_probe_begin(t_mx_stat_site *site) {
+    if (!atomic_load_explicit(&site->linked, memory_order_relaxed)) {
+        site_link(site);
+    }
+    MX_ADD(site->calls, 1);
+
+    t_mx_probe probe = {site, probe_cur, 0};
+    probe_cur = site;
+    probe.start = ticks();
+    return probe;
+}
+
+void mx_probe_end(t_mx_probe *probe) {
+    uint64_t end = ticks();
+
+    MX_ADD(probe->site->cycles, end - probe->start);
+    probe_cur = probe->outer;
+}
+
+void *mx_stat_malloc(size_t size) {
+    return charge_alloc(malloc(size));
+}
+
+void *mx_stat_aligned_alloc(size_t align, size_t size) {
+    return charge_alloc(aligned_alloc(align, size));
+}
+
+void mx_stat_free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    size_t size = malloc_usable_size(ptr);
+    t_mx_stat_site *site = charged_site();
+    MX_ADD(site->frees, 1);
+    MX_ADD(site->free_bytes, size);
+    MX_ADD(total_frees, 1);
+    live_add(-(int64_t)size);
+    free(ptr);
+}
@@ -0,0 +1,397 @@
+/**
+ * @file mx_str.c
+ * @brief Length-carrying strings with small-string optimization.
+ *
+ * A t_mx_str stores its length and capacity next to the bytes, so no
+ * operation here has to rescan for the terminating '\0'. Strings of up to
+ * MX_STR_SMALL bytes live inline in the struct and need no allocation.
+ * The bytes are always '\0'-terminated, so mx_str_data can be passed to
+ * any function taking a plain char *, and mx_str_from / mx_str_release
+ * convert in each direction.
+ *
+ * A t_mx_str doubles as a string builder: appends grow the heap buffer
+ * geometrically, and mx_str_release hands it over without a copy. The
+ * mx_*_str variants of C-string functions append their result to an
+ * initialized t_mx_str instead of allocating a new string, so building
+ * output from many pieces costs amortized O(1) per byte. When an append
+ * fails, the string is left as it was.
+ *
+ * All functions returning int return 0 on success and -1 on invalid
+ * arguments or allocation failure.
+ *
+ * Functions:
+ * - void mx_str_init(t_mx_str *s): Initializes an empty string.
+ * - int mx_str_from(t_mx_str *s, const char *cstr): Initializes a string from a C string.
+ * - int mx_str_from_len(t_mx_str *s, const char *data, size_t len): Initializes a string from len bytes.
+ * - void mx_str_free(t_mx_str *s): Frees the string and leaves it empty.
+ * - char *mx_str_data(const t_mx_str *s): Returns the '\0'-terminated bytes.
+ * - size_t mx_str_len(const t_mx_str *s): Returns the length.
+ * - int mx_str_reserve(t_mx_str *s, size_t cap): Makes room for cap bytes.
+ * - int mx_str_cat(t_mx_str *s, const char *data, size_t len): Appends len bytes.
+ * - int mx_str_cat_char(t_mx_str *s, char c): Appends one character.
+ * - int mx_str_cat_cstr(t_mx_str *s, const char *cstr): Appends a C string.
+ * - int mx_str_cat_int(t_mx_str *s, int64_t n): Appends n in decimal.
+ * - int mx_str_cat_hex(t_mx_str *s, uint64_t n): Appends n in hexadecimal.
+ * - int mx_str_dup(t_mx_str *dst, const t_mx_str *src): Initializes dst as a copy of src.
+ * - int mx_str_join(t_mx_str *dst, const t_mx_str *s1, const t_mx_str *s2): Initializes dst as s1 followed by s2.
+ * - int mx_str_trim(t_mx_str *dst, const t_mx_str *src): Initializes dst as src without surrounding whitespace.
+ * - t_mx_str *mx_str_split(const t_mx_str *src, char c, size_t *count): Splits src into an array of strings.
+ * - int mx_str_replace(t_mx_str *dst, const t_mx_str *src, const t_mx_str *sub, const t_mx_str *replace): Initializes dst as src with every sub replaced.
+ * - char *mx_str_release(t_mx_str *s): Hands the bytes over as a malloc'd C string.
+ * - int mx_replace_substr_str(t_mx_str *dst, const char *str, const char *sub, const char *replace): Appends mx_replace_substr's result.
+ * - int mx_strtrim_str(t_mx_str *dst, const char *str): Appends mx_strtrim's result.
+ * - int mx_del_extra_spaces_str(t_mx_str *dst, const char *str): Appends mx_del_extra_spaces's result.
+ */
+
+#include "../inc/libmx.h"
+
+// Drops whatever was appended past len, used to undo a failed append
+static void str_cut(t_mx_str *s, size_t len) {
+    s->len = len;
+    mx_str_data(s)[len] = '\0';
+}
+
+static void trim_bounds(const char *p, size_t *start, size_t *end) {
+    *start += mx_space_span(p + *start, *end - *start);
+    while (*end > *start && mx_isspace(p[*end - 1])) {
+        (*end)--;
+    }
+}
+
+void mx_str_init(t_mx_str *s) {
+    if (s == NULL) {
+        return;
+    }
+
+    s->len = 0;
+    s->cap = 0;
+    s->u.small[0] = '\0';
+}
+
+int mx_str_from_len(t_mx_str *s, const char *data, size_t len) {
+    if (s == NULL || (data == NULL && len > 0)) {
+        return -1;
+    }
+
+    mx_str_init(s);
+    return mx_str_cat(s, data, len);
+}
+
+int mx_str_from(t_mx_str *s, const char *cstr) {
+    if (cstr == NULL) {
+        return -1;
+    }
+
+    return mx_str_from_len(s, cstr, mx_strlen(cstr));
+}
+
+void mx_str_free(t_mx_str *s) {
+    MX_PROBE();
+    if (s == NULL) {
+        return;
+    }
+
+    if (s->cap) {
+        MX_FREE(s->u.heap);
+    }
+    mx_str_init(s);
+}
+
+char *mx_str_data(const t_mx_str *s) {
+    if (s == NULL) {
+        return NULL;
+    }
+
+    return s->cap ? s->u.heap : (char *)s->u.small;
+}
+
+size_t mx_str_len(const t_mx_str *s) {
+    return s ? s->len : 0;
+}
+
+/*
+ * Moves the bytes to the heap once they outgrow the inline buffer. Heap
+ * growth goes through mx_realloc_grow, so repeated appends are amortized.
+ */
+int mx_str_reserve(t_mx_str *s, size_t cap) {
+    MX_PROBE();
+    if (s == NULL) {
+        return -1;
+    }
+    if (cap <= (s->cap ? s->cap : MX_STR_SMALL)) {
+        return 0;
+    }
+
+    if (s->cap) {
+        char *grown = mx_realloc_grow(s->u.heap, cap + 1);
+        if (grown == NULL) {
+            return -1;
+        }
+        s->u.heap = grown;
+    } else {
+        char *heap = (char *)MX_MALLOC(cap + 1);
+        if (heap == NULL) {
+            return -1;
+        }
+        mx_memcpy(heap, s->u.small, s->len + 1);
+        s->u.heap = heap;
+    }
+    s->cap = malloc_usable_size(s->u.heap) - 1;
+    return 0;
+}
+
+// Appends that fit the spare capacity skip mx_str_reserve
+#define MX_STR_CAP(s) ((s)->cap ? (s)->cap : MX_STR_SMALL)
+
+int mx_str_cat(t_mx_str *s, const char *data, size_t len) {
+    if (s == NULL || (data == NULL && len > 0)) {
+        return -1;
+    }
+    if (len > MX_STR_CAP(s) - s->len && mx_str_reserve(s, s->len + len) < 0) {
+        return -1;
+    }
+
+    char *p = mx_str_data(s);
+    mx_memcpy(p + s->len, data, len);
+    s->len += len;
+    p[s->len] = '\0';
+    return 0;
+}
+
+int mx_str_cat_char(t_mx_str *s, char c) {
+    if (s == NULL) {
+        return -1;
+    }
+    if (s->len == MX_STR_CAP(s) && mx_str_reserve(s, s->len + 1) < 0) {
+        return -1;
+    }
+
+    char *p = mx_str_data(s);
+    p[s->len++] = c;
+    p[s->len] = '\0';
+    return 0;
+}
+
+int mx_str_cat_cstr(t_mx_str *s, const char *cstr) {
+    if (cstr == NULL) {
+        return -1;
+    }
+
+    return mx_str_cat(s, cstr, mx_strlen(cstr));
+}
+
+// Numbers are formatted straight into the spare capacity
+int mx_str_cat_int(t_mx_str *s, int64_t n) {
+    if (s == NULL || mx_str_reserve(s, s->len + MX_NBR_BUF - 1) < 0) {
+        return -1;
+    }
+
+    s->len += mx_i64_to_buf(n, mx_str_data(s) + s->len);
+    return 0;
+}
+
+int mx_str_cat_hex(t_mx_str *s, uint64_t n) {
+    if (s == NULL || mx_str_reserve(s, s->len + MX_NBR_BUF - 1) < 0) {
+        return -1;
+    }
+
+    s->len += mx_hex_to_buf(n, mx_str_data(s) + s->len);
+    return 0;
+}
+
+int mx_str_dup(t_mx_str *dst, const t_mx_str *src) {
+    if (src == NULL) {
+        return -1;
+    }
+
+    return mx_str_from_len(dst, mx_str_data(src), src->len);
+}
+
+int mx_str_join(t_mx_str *dst, const t_mx_str *s1, const t_mx_str *s2) {
+    if (dst == NULL || s1 == NULL || s2 == NULL) {
+        return -1;
+    }
+
+    mx_str_init(dst);
+    if (mx_str_reserve(dst, s1->len + s2->len) < 0
+        || mx_str_cat(dst, mx_str_data(s1), s1->len) < 0
+        || mx_str_cat(dst, mx_str_data(s2), s2->len) < 0) {
+        mx_str_free(dst);
+        return -1;
+    }
+    return 0;
+}
+
+int mx_str_trim(t_mx_str *dst, const t_mx_str *src) {
+    if (src == NULL) {
+        return -1;
+    }
+
+    const char *p = mx_str_data(src);
+    size_t start = 0;
+    size_t end = src->len;
+
+    trim_bounds(p, &start, &end);
+    return mx_str_from_len(dst, p + start, end - start);
+}
+
+t_mx_str *mx_str_split(const t_mx_str *src, char c, size_t *count) {
+    MX_PROBE();
+    if (src == NULL || count == NULL) {
+        return NULL;
+    }
+
+    const char *p = mx_str_data(src);
+    const char *end = p + src->len;
+    t_mx_str *words = NULL;
+    size_t n = 0;
+
+    while (p < end) {
+        while (p < end && *p == c) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+        const char *stop = mx_memchr(p, c, end - p);
+        if (stop == NULL) {
+            stop = end;
+        }
+
+        t_mx_str *grown = mx_realloc_grow(words, (n + 1) * sizeof(t_mx_str));
+        if (grown == NULL || mx_str_from_len(&grown[n], p, stop - p) < 0) {
+            words = grown ? grown : words;
+            while (n > 0) {
+                mx_str_free(&words[--n]);
+            }
+            MX_FREE(words);
+            return NULL;
+        }
+        words = grown;
+        n++;
+        p = stop;
+    }
+
+    if (words == NULL) {
+        // An empty result is still a valid array, distinct from failure
+        words = (t_mx_str *)MX_MALLOC(sizeof(t_mx_str));
+        if (words == NULL) {
+            return NULL;
+        }
+    }
+    *count = n;
+    return words;
+}
+
+static int cat_replace(t_mx_str *dst, const char *p, size_t len,
+                       const char *sub, size_t sub_len,
+                       const char *rep, size_t rep_len) {
+    if (sub_len == 0) {
+        return mx_str_cat(dst, p, len);
+    }
+
+    t_mx_needle needle;
+    mx_needle_init(&needle, sub, sub_len);
+
+    const char *end = p + len;
+    const char *hit;
+    size_t mark = dst->len;
+
+    while ((hit = mx_needle_find(&needle, p, end - p)) != NULL) {
+        if (mx_str_cat(dst, p, hit - p) < 0
+            || mx_str_cat(dst, rep, rep_len) < 0) {
+            str_cut(dst, mark);
+            return -1;
+        }
+        p = hit + sub_len;
+    }
+    if (mx_str_cat(dst, p, end - p) < 0) {
+        str_cut(dst, mark);
+        return -1;
+    }
+    return 0;
+}
+
+int mx_str_replace(t_mx_str *dst, const t_mx_str *src, const t_mx_str *sub,
+                   const t_mx_str *replace) {
+    if (dst == NULL || src == NULL || sub == NULL || replace == NULL) {
+        return -1;
+    }
+
+    mx_str_init(dst);
+    if (cat_replace(dst, mx_str_data(src), src->len, mx_str_data(sub),
+                    sub->len, mx_str_data(replace), replace->len) < 0) {
+        mx_str_free(dst);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Heap strings are handed over as they are; inline ones are copied out.
+ * Either way s is left empty.
+ */
+char *mx_str_release(t_mx_str *s) {
+    MX_PROBE();
+    if (s == NULL) {
+        return NULL;
+    }
+
+    char *res;
+    if (s->cap) {
+        res = s->u.heap;
+    } else {
+        res = (char *)MX_MALLOC(s->len + 1);
+        if (res == NULL) {
+            return NULL;
+        }
+        mx_memcpy(res, s->u.small, s->len + 1);
+    }
+    mx_str_init(s);
+    return res;
+}
+
+int mx_replace_substr_str(t_mx_str *dst, const char *str, const char *sub,
+                          const char *replace) {
+    MX_PROBE();
+    if (dst == NULL || str == NULL || sub == NULL || replace == NULL) {
+        return -1;
+    }
+
+    return cat_replace(dst, str, mx_strlen(str), sub, mx_strlen(sub),
+                       replace, mx_strlen(replace));
+}
+
+int mx_strtrim_str(t_mx_str *dst, const char *str) {
+    MX_PROBE();
+    if (dst == NULL || str == NULL) {
+        return -1;
+    }
+
+    size_t start = 0;
+    size_t end = mx_strlen(str);
+
+    trim_bounds(str, &start, &end);
+    return mx_str_cat(dst, str + start, end - start);
+}
+
+// Whitespace runs become one space, and none is kept at either end
+int mx_del_extra_spaces_str(t_mx_str *dst, const char *str) {
+    MX_PROBE();
+    if (dst == NULL || str == NULL) {
+        return -1;
+    }
+
+    size_t len = mx_strlen(str);
+    if (mx_str_reserve(dst, dst->len + len) < 0) {
+        return -1;
+    }
+
+    t_mx_space_norm st;
+    mx_space_norm_init(&st);
+    char *out = mx_str_data(dst) + dst->len;
+    size_t n = mx_space_norm(&st, str, len, out);
+    out[n] = '\0';
+    dst->len += n;
+    return 0;
+}
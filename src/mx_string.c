@@ -31,26 +31,287 @@
  * - char *mx_strjoin(const char *s1, const char *s2): Joins two strings into a new string.
  * - char *mx_file_to_str(const char *file): Reads the contents of a file into a string.
  * - char *mx_replace_substr(const char *str, const char *sub, const char *replace): Replaces all occurrences of a substring in a string with another substring.
+ * - char *mx_replace_needle(const char *str, const t_mx_needle *needle, const char *replace): Same as mx_replace_substr with a precompiled needle.
+ * - char *mx_replace_substrs(const char *str, const char *const *subs, const char *const *replaces, int count): Replaces several substrings in a single pass.
  * - int mx_read_line(char **lineptr, size_t buf_size, char delim, const int fd): Reads a line from a file descriptor.
  */
 
 #include "../inc/libmx.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MX_HAVE_X86 1
+#endif
+
+/*
+ * String scanning kernels. The terminator is only found by reading, so
+ * these read whole words or vectors and may look at bytes past it. An
+ * aligned load never crosses a page boundary, so it cannot fault when
+ * its first byte is readable; mx_strcmp, which walks two strings with
+ * unrelated alignment, checks the page offset of both before each wide
+ * load instead. Those over-reads are invisible to the program but not
+ * to AddressSanitizer, hence MX_SCAN.
+ */
+#define MX_SCAN __attribute__((no_sanitize_address))
+
+typedef size_t __attribute__((__may_alias__, __aligned__(1))) t_mx_uword;
+
+#define MX_WORD sizeof(size_t)
+#define MX_ONES ((size_t)-1 / 0xFF)
+#define MX_HIGHS (MX_ONES * 0x80)
+#define MX_HAS_ZERO(x) (((x) - MX_ONES) & ~(x) & MX_HIGHS)
+#define MX_PAGE 4096
+
+// Whether n bytes from p stay inside p's page
+#define MX_IN_PAGE(p, n) (((uintptr_t)(p) & (MX_PAGE - 1)) <= MX_PAGE - (n))
+
+MX_SCAN
+static size_t strlen_word(const char *s) {
+    const char *p = s;
+
+    for (; (uintptr_t)p & (MX_WORD - 1); p++) {
+        if (*p == '\0') {
+            return p - s;
+        }
+    }
+    while (!MX_HAS_ZERO(*(const t_mx_uword *)p)) {
+        p += MX_WORD;
+    }
+    while (*p) p++;
+    return p - s;
+}
+
+// First c or terminator, whichever comes first
+MX_SCAN
+static const char *strchrnul_word(const char *s, char c) {
+    size_t pattern = MX_ONES * (unsigned char)c;
+
+    for (; (uintptr_t)s & (MX_WORD - 1); s++) {
+        if (*s == '\0' || *s == c) {
+            return s;
+        }
+    }
+    for (;; s += MX_WORD) {
+        size_t w = *(const t_mx_uword *)s;
+        if (MX_HAS_ZERO(w) | MX_HAS_ZERO(w ^ pattern)) {
+            break;
+        }
+    }
+    while (*s && *s != c) s++;
+    return s;
+}
+
+// Index of the first differing byte or of the common terminator
+MX_SCAN
+static size_t strcmp_word(const char *s1, const char *s2) {
+    size_t i = 0;
+
+    while (true) {
+        if (MX_IN_PAGE(s1 + i, MX_WORD) && MX_IN_PAGE(s2 + i, MX_WORD)) {
+            size_t w = *(const t_mx_uword *)(s1 + i);
+            if (w == *(const t_mx_uword *)(s2 + i) && !MX_HAS_ZERO(w)) {
+                i += MX_WORD;
+                continue;
+            }
+        }
+        for (size_t k = 0; k < MX_WORD; k++, i++) {
+            if (s1[i] != s2[i] || s1[i] == '\0') {
+                return i;
+            }
+        }
+    }
+}
+
+#ifdef MX_HAVE_X86
+
+__attribute__((target("sse2"))) MX_SCAN
+static size_t strlen_sse2(const char *s) {
+    const char *p = (const char *)((uintptr_t)s & ~(uintptr_t)15);
+    __m128i zero = _mm_setzero_si128();
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), zero));
+
+    mask >>= s - p;
+    if (mask) {
+        return __builtin_ctz(mask);
+    }
+    while (true) {
+        p += 16;
+        mask = (unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), zero));
+        if (mask) {
+            return p + __builtin_ctz(mask) - s;
+        }
+    }
+}
+
+__attribute__((target("sse2"))) MX_SCAN
+static const char *strchrnul_sse2(const char *s, char c) {
+    const char *p = (const char *)((uintptr_t)s & ~(uintptr_t)15);
+    __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_set1_epi8(c);
+    __m128i x = _mm_load_si128((const __m128i *)p);
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(x, zero), _mm_cmpeq_epi8(x, v)));
+
+    mask >>= s - p;
+    if (mask) {
+        return s + __builtin_ctz(mask);
+    }
+    while (true) {
+        p += 16;
+        x = _mm_load_si128((const __m128i *)p);
+        mask = (unsigned)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(x, zero), _mm_cmpeq_epi8(x, v)));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+}
+
+__attribute__((target("sse2"))) MX_SCAN
+static size_t strcmp_sse2(const char *s1, const char *s2) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i ones = _mm_set1_epi8(-1);
+    size_t i = 0;
+
+    while (true) {
+        if (MX_IN_PAGE(s1 + i, 16) && MX_IN_PAGE(s2 + i, 16)) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(s1 + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(s2 + i));
+            unsigned stop = (unsigned)_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(a, zero),
+                             _mm_xor_si128(_mm_cmpeq_epi8(a, b), ones)));
+            if (stop) {
+                return i + __builtin_ctz(stop);
+            }
+            i += 16;
+            continue;
+        }
+        // Near a page end: step over the boundary bytewise
+        for (size_t k = 0; k < 16; k++, i++) {
+            if (s1[i] != s2[i] || s1[i] == '\0') {
+                return i;
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2"))) MX_SCAN
+static size_t strlen_avx2(const char *s) {
+    const char *p = (const char *)((uintptr_t)s & ~(uintptr_t)31);
+    __m256i zero = _mm256_setzero_si256();
+    unsigned mask = (unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), zero));
+
+    mask >>= s - p;
+    if (mask) {
+        return __builtin_ctz(mask);
+    }
+    while (true) {
+        p += 32;
+        mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), zero));
+        if (mask) {
+            return p + __builtin_ctz(mask) - s;
+        }
+    }
+}
+
+__attribute__((target("avx2"))) MX_SCAN
+static const char *strchrnul_avx2(const char *s, char c) {
+    const char *p = (const char *)((uintptr_t)s & ~(uintptr_t)31);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i v = _mm256_set1_epi8(c);
+    __m256i x = _mm256_load_si256((const __m256i *)p);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, zero), _mm256_cmpeq_epi8(x, v)));
+
+    mask >>= s - p;
+    if (mask) {
+        return s + __builtin_ctz(mask);
+    }
+    while (true) {
+        p += 32;
+        x = _mm256_load_si256((const __m256i *)p);
+        mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, zero),
+                            _mm256_cmpeq_epi8(x, v)));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+}
+
+__attribute__((target("avx2"))) MX_SCAN
+static size_t strcmp_avx2(const char *s1, const char *s2) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i ones = _mm256_set1_epi8(-1);
+    size_t i = 0;
+
+    while (true) {
+        if (MX_IN_PAGE(s1 + i, 32) && MX_IN_PAGE(s2 + i, 32)) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(s1 + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(s2 + i));
+            unsigned stop = (unsigned)_mm256_movemask_epi8(
+                _mm256_or_si256(_mm256_cmpeq_epi8(a, zero),
+                                _mm256_xor_si256(_mm256_cmpeq_epi8(a, b), ones)));
+            if (stop) {
+                return i + __builtin_ctz(stop);
+            }
+            i += 32;
+            continue;
+        }
+        for (size_t k = 0; k < 32; k++, i++) {
+            if (s1[i] != s2[i] || s1[i] == '\0') {
+                return i;
+            }
+        }
+    }
+}
+
+#endif /* MX_HAVE_X86 */
+
+// Kernel table, upgraded from CPUID at load time like mx_memory.c's
+static struct {
+    size_t (*len)(const char *);
+    const char *(*chrnul)(const char *, char);
+    size_t (*cmp)(const char *, const char *);
+} str_ops = {strlen_word, strchrnul_word, strcmp_word};
+
+__attribute__((constructor))
+static void str_ops_init(void) {
+#ifdef MX_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        str_ops.len = strlen_avx2;
+        str_ops.chrnul = strchrnul_avx2;
+        str_ops.cmp = strcmp_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        str_ops.len = strlen_sse2;
+        str_ops.chrnul = strchrnul_sse2;
+        str_ops.cmp = strcmp_sse2;
+    }
+#endif
+}
+
 /**
     * mx_strlen - Computes the length of a string
     * @s: The string to measure
 */
 int mx_strlen(const char *s) {
+    MX_PROBE();
     if (s == NULL) {
         return -2;
     }
 
-    const char *p = s;
-    while (*p) p++;
-    return p - s;
+    size_t len = str_ops.len(s);
+    MX_PROBE_BYTES(len);
+    return (int)len;
 }
 
 void mx_swap_char(char *s1, char *s2) {
+    MX_PROBE();
     if (!(s1 && s2)) {
         return;
     }
@@ -61,6 +322,7 @@ void mx_swap_char(char *s1, char *s2) {
 }
 
 void mx_str_reverse(char *s) {
+    MX_PROBE();
     if (s == NULL) {
         return;
     }
@@ -72,15 +334,17 @@ void mx_str_reverse(char *s) {
 }
 
 void mx_strdel(char **str) {
+    MX_PROBE();
     if (str == NULL) {
         return;
     }
 
-    free(*str);
+    MX_FREE(*str);
     *str = NULL;
 }
 
 void mx_del_strarr(char ***arr) {
+    MX_PROBE();
     if (arr == NULL || *arr == NULL) {
         return;
     }
@@ -89,80 +353,82 @@ void mx_del_strarr(char ***arr) {
         mx_strdel(&(*arr)[i]);
     }
 
-    free(*arr);
+    MX_FREE(*arr);
     *arr = NULL;
 }
 
 int mx_get_char_index(const char *str, char s) {
+    MX_PROBE();
     if (str == NULL) {
         return -2;
     }
-
-    for (int i = 0; i < mx_strlen(str); ++i) {
-        if (s == str[i]) return i;
+    // The terminator itself is never reported
+    if (s == '\0') {
+        return -1;
     }
 
-    return -1;
+    const char *p = str_ops.chrnul(str, s);
+    MX_PROBE_BYTES(p - str + 1);
+    return *p == s ? (int)(p - str) : -1;
 }
 
 char *mx_strdup(const char *s1) {
+    MX_PROBE();
     if (s1 == NULL) {
         return NULL;
     }
 
     int len = mx_strlen(s1);
 
-    char *res = (char*)malloc(len + 1);
+    char *res = (char*)MX_MALLOC(len + 1);
 
     if (!res) {
         return NULL;
     }
 
-    for (int i = 0; i <= len; ++i) {
-        res[i] = s1[i];
-    }
+    MX_PROBE_BYTES(len + 1);
+    mx_memcpy(res, s1, len + 1);
 
     return res;
 }
 
 char *mx_strndup(const char *s1, size_t n) {
+    MX_PROBE();
     if (s1 == NULL) {
         return NULL;
     }
 
-    if ((int)n > mx_strlen(s1)) n = mx_strlen(s1);
+    // Bounded scan: never looks past the first n bytes
+    size_t len = 0;
+    while (len < n && s1[len]) len++;
 
-    char *res = (char*)malloc(n + 1);
+    char *res = (char*)MX_MALLOC(len + 1);
 
     if (!res) {
         return NULL;
     }
 
-    for (int i = 0; i < (int)n; ++i) {
-        res[i] = s1[i];
-    }
+    MX_PROBE_BYTES(len);
+    mx_memcpy(res, s1, len);
 
-    res[n] = '\0';
+    res[len] = '\0';
 
     return res;
 }
 
 char *mx_strcpy(char *dst, const char *src) {
+    MX_PROBE();
     if (src == NULL) {
         return NULL;
     }
 
-    char *buf = dst;
-    while (*src) {
-        *dst++ = *src++;
-    }
-
-    *dst = '\0';
-
-    return buf;
+    size_t len = str_ops.len(src) + 1;
+    MX_PROBE_BYTES(len);
+    return mx_memcpy(dst, src, len);
 }
 
 char *mx_strncpy(char *dst, const char *src, int len) {
+    MX_PROBE();
     if (src == NULL || dst == NULL || len < 0) {
         return NULL;
     }
@@ -185,76 +451,44 @@ char *mx_strncpy(char *dst, const char *src, int len) {
 }
 
 int mx_strcmp(const char *s1, const char *s2) {
-    
+    MX_PROBE();
     if (s1 == NULL || s2 == NULL) {
-        return -2; 
-    }
-
-    
-    while (*s1 && *s2) {
-        if (*s1 != *s2) {
-            return *s1 - *s2; 
-        }
-        s1++;
-        s2++;
+        return -2;
     }
 
-    
-    return *s1 - *s2; 
+    size_t i = str_ops.cmp(s1, s2);
+    MX_PROBE_BYTES(i + 1);
+    return s1[i] - s2[i];
 }
 
-
 char *mx_strcat(char *restrict s1, const char *restrict s2) {
+    MX_PROBE();
     if (s1 == NULL || s2 == NULL) {
         return NULL;
     }
 
-    char *buf = s1;
-
-    while (*s1) {
-        s1++;
-    }
-
-    while (*s2) {
-        *s1++ = *s2++;
-    }
-
-    *s1 = '\0';
-    return buf;
+    size_t len1 = str_ops.len(s1);
+    size_t len2 = str_ops.len(s2) + 1;
+    MX_PROBE_BYTES(len1 + len2);
+    mx_memcpy(s1 + len1, s2, len2);
+    return s1;
 }
 
 char *mx_strstr(const char *haystack, const char *needle) {
-    
+    MX_PROBE();
     if (!needle || *needle == '\0') {
         return (char *)haystack;
     }
-
-    
-    while (*haystack) {
-        const char *h = haystack;
-        const char *n = needle;
-
-        
-        while (*h && *n && *h == *n) {
-            h++;
-            n++;
-        }
-
-        
-        if (*n == '\0') {
-            return (char *)haystack;
-        }
-
-        
-        haystack++;
+    if (haystack == NULL) {
+        return NULL;
     }
 
-    
-    return NULL;
+    return mx_memmem(haystack, mx_strlen(haystack), needle, mx_strlen(needle));
 }
 
 
 int mx_get_substr_index(const char *str, const char *sub) {
+    MX_PROBE();
     if (str == NULL || sub == NULL) {
         return -2;
     }
@@ -268,6 +502,7 @@ int mx_get_substr_index(const char *str, const char *sub) {
 }
 
 int mx_count_substr(const char *str, const char *sub) {
+    MX_PROBE();
     if (sub == NULL || str == NULL) {
         return -1;
     }
@@ -276,19 +511,24 @@ int mx_count_substr(const char *str, const char *sub) {
         return 0;
     }
 
+    t_mx_needle needle;
+    mx_needle_init(&needle, sub, mx_strlen(sub));
+
     const char *buf = str;
+    const char *end = str + mx_strlen(str);
 
     int count = 0;
 
-    while ((buf = mx_strstr(buf, sub)) != NULL) {
+    while ((buf = mx_needle_find(&needle, buf, end - buf)) != NULL) {
         count++;
-        buf++;  
+        buf++;
     }
 
     return count;
 }
 
 int mx_count_words(const char *str, char c) {
+    MX_PROBE();
     if (str == NULL) {
         return -1;
     }
@@ -309,8 +549,9 @@ int mx_count_words(const char *str, char c) {
 }
 
 char *mx_strnew(const int size) {
+    MX_PROBE();
     if (size < 0) return NULL;
-    char *res = (char *)malloc(size + 1);
+    char *res = (char *)MX_MALLOC(size + 1);
     if (res == NULL) return NULL;
 
     for (int i = 0; i <= size; ++i) {
@@ -321,124 +562,73 @@ char *mx_strnew(const int size) {
 }
 
 
-bool is_space(char c) {
-    return (c == ' ' || c == '\n' || c == '\t' || c == '\f');
-}
-
+/*
+ * The trimming and squeezing themselves live in mx_str.c, these wrap
+ * the builder variants for callers that want a plain string.
+ */
 char *mx_strtrim(const char *str) {
-    if (str == NULL) {
-        return NULL;
-    }
-
-    int start = 0;
-    int end = mx_strlen(str) - 1;
-    
-    
-
-    
-    while (is_space(str[start])) {
-        start++;
-    }
-
-    
-    while (end >= start && is_space(str[end])) {
-        end--;
-    }
-
-    
-    int new_len = end - start + 1;
-    if (new_len <= 0) {
-        return mx_strnew(0); 
-    }
+    MX_PROBE();
+    t_mx_str res;
 
-    
-    char *trimmed_str = mx_strnew(new_len);
-    if (trimmed_str == NULL) {
+    mx_str_init(&res);
+    if (mx_strtrim_str(&res, str) < 0) {
+        mx_str_free(&res);
         return NULL;
     }
-
-    
-    for (int i = 0; i < new_len; i++) {
-        trimmed_str[i] = str[start + i];
-    }
-
-    return trimmed_str;
+    return mx_str_release(&res);
 }
 
 char *mx_del_extra_spaces(const char *str) {
-    if (str == NULL) {
-        return NULL; 
-    }
-
-    int length = mx_strlen(str);
-    char *result = mx_strnew(length); 
-
-    if (result == NULL) {
-        return NULL; 
-    }
-
-    int j = 0; 
-    bool in_space = false; 
-
-    for (int i = 0; i < length; i++) {
-        if (!is_space((unsigned char)str[i])) {
-            result[j++] = str[i];
-            in_space = false;
-        } else if (!in_space && j > 0) { 
-            result[j++] = ' ';
-            in_space = true;
-        }
-    }
+    MX_PROBE();
+    t_mx_str res;
 
-    
-    if (j > 0 && result[j - 1] == ' ') {
-        result[j - 1] = '\0'; 
-    } else {
-        result[j] = '\0'; 
+    mx_str_init(&res);
+    if (mx_del_extra_spaces_str(&res, str) < 0) {
+        mx_str_free(&res);
+        return NULL;
     }
-
-    return result; 
+    return mx_str_release(&res);
 }
 
 char **mx_strsplit(const char *str, char c) {
+    MX_PROBE();
     if (str == NULL) {
         return NULL; 
     }
 
-    int word_count = mx_count_words(str, c); 
-    char **result = (char **)malloc((word_count + 1) * sizeof(char *)); 
+    t_mx_split_iter it;
+    t_mx_slice word;
+    char **result = (char **)MX_MALLOC(sizeof(char *));
+    size_t index = 0;
 
     if (result == NULL) {
         return NULL; 
     }
+    result[0] = NULL;
 
-    int index = 0;
-    int start = -1;
+    mx_split_init(&it, str, mx_strlen(str), c, 0);
 
-    for (int i = 0; str[i]; i++) {
-        if (str[i] != c) {
-            if (start == -1) {
-                start = i; 
-            }
-        } else {
-            if (start != -1) {
-                result[index++] = mx_strndup(str + start, i - start); 
-                start = -1; 
-            }
+    // One pass: the array grows geometrically and stays NULL-terminated
+    while (mx_split_next(&it, &word)) {
+        char **grown = mx_realloc_grow(result, (index + 2) * sizeof(char *));
+        if (grown == NULL) {
+            mx_del_strarr(&result);
+            return NULL;
         }
+        result = grown;
+        result[index] = mx_strndup(str + word.offset, word.len);
+        if (result[index] == NULL) {
+            mx_del_strarr(&result);
+            return NULL;
+        }
+        result[++index] = NULL;
     }
 
-    
-    if (start != -1) {
-        result[index++] = mx_strndup(str + start, mx_strlen(str) - start);
-    }
-
-    result[index] = NULL; 
-
     return result; 
 }
 
 char *mx_strjoin(const char *s1, const char *s2) {
+    MX_PROBE();
     
     if (s1 == NULL && s2 == NULL) {
         return NULL;
@@ -457,20 +647,21 @@ char *mx_strjoin(const char *s1, const char *s2) {
     int len2 = mx_strlen(s2);
     
     
-    char *result = mx_strnew(len1 + len2);
+    char *result = (char *)MX_MALLOC(len1 + len2 + 1);
     if (result == NULL) {
         return NULL; 
     }
 
     
-    mx_strcpy(result, s1);
+    mx_memcpy(result, s1, len1);
     
-    mx_strcat(result, s2);
+    mx_memcpy(result + len1, s2, len2 + 1);
     
     return result; 
 }
 
 char *mx_file_to_str(const char *file) {
+    MX_PROBE();
     if (file == NULL) {
         return NULL;
     }
@@ -481,121 +672,200 @@ char *mx_file_to_str(const char *file) {
         return NULL;
     }
 
-    char buf[1];
-    int len = 0;
-    while (read(fd, buf, 1)) {
-        len++;
-    }
+    char *result = mx_fd_to_str(fd, NULL);
 
     close(fd);
 
+    return result;
+}
 
-    fd = open(file, O_RDONLY);
-    if (fd < 0) {
-        return NULL;
-    }
+typedef struct  s_match {
+    size_t at;
+    int idx;
+}               t_match;
 
-    char *result = mx_strnew(len);
+// Patterns handled without a heap allocation for their bookkeeping
+#define MX_REPLACE_STACK 8
 
-    if (result == NULL) {
+/*
+ * One left-to-right scan over str records every non-overlapping match
+ * together with the pattern it belongs to. At each step the earliest
+ * pending match wins, ties going to the pattern listed first. The result
+ * is then sized exactly and emitted with block copies.
+ */
+static char *replace_core(const char *str, const t_mx_needle *needles,
+                          const char *const *replaces, int count) {
+    size_t len = mx_strlen(str);
+    size_t none = len + 1;
+    size_t stack[2 * MX_REPLACE_STACK];
+    size_t *next = count <= MX_REPLACE_STACK
+                   ? stack : MX_MALLOC(2 * count * sizeof(size_t));
+    if (next == NULL) {
         return NULL;
     }
+    size_t *rep_len = next + count;
 
-    read(fd, result, len);
+    for (int i = 0; i < count; i++) {
+        rep_len[i] = mx_strlen(replaces[i]);
+        const char *hit = needles[i].len ? mx_needle_find(&needles[i], str, len)
+                                         : NULL;
+        next[i] = hit ? (size_t)(hit - str) : none;
+    }
 
-    close(fd);
+    t_match *matches = NULL;
+    size_t n_matches = 0;
+    size_t out_len = len;
+    bool failed = false;
+
+    while (true) {
+        int best = -1;
+        for (int i = 0; i < count; i++) {
+            if (next[i] != none && (best < 0 || next[i] < next[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+
+        t_match *grown = mx_realloc_grow(matches,
+                                         (n_matches + 1) * sizeof(t_match));
+        if (grown == NULL) {
+            failed = true;
+            break;
+        }
+        matches = grown;
+        matches[n_matches].at = next[best];
+        matches[n_matches++].idx = best;
+        out_len += rep_len[best] - needles[best].len;
+
+        size_t pos = next[best] + needles[best].len;
+        for (int i = 0; i < count; i++) {
+            if (next[i] != none && next[i] < pos) {
+                const char *hit = mx_needle_find(&needles[i], str + pos,
+                                                 len - pos);
+                next[i] = hit ? (size_t)(hit - str) : none;
+            }
+        }
+    }
+
+    char *result = NULL;
+    if (!failed) {
+        result = n_matches ? (char *)MX_MALLOC(out_len + 1) : mx_strdup(str);
+    }
+    if (result != NULL && n_matches) {
+        size_t src = 0;
+        size_t dst = 0;
+        for (size_t k = 0; k < n_matches; k++) {
+            int idx = matches[k].idx;
+            mx_memcpy(result + dst, str + src, matches[k].at - src);
+            dst += matches[k].at - src;
+            mx_memcpy(result + dst, replaces[idx], rep_len[idx]);
+            dst += rep_len[idx];
+            src = matches[k].at + needles[idx].len;
+        }
+        mx_memcpy(result + dst, str + src, len - src);
+        result[out_len] = '\0';
+    }
 
+    MX_FREE(matches);
+    if (next != stack) {
+        MX_FREE(next);
+    }
     return result;
 }
 
 char *mx_replace_substr(const char *str, const char *sub, const char *replace) {
+    MX_PROBE();
     if (str == NULL || sub == NULL || replace == NULL) {
         return NULL;
     }
 
-    int sub_count = mx_count_substr(str, sub);
-    if (sub_count == 0) {
-        return mx_strdup(str);
+    t_mx_needle needle;
+    mx_needle_init(&needle, sub, mx_strlen(sub));
+    return replace_core(str, &needle, &replace, 1);
+}
+
+char *mx_replace_needle(const char *str, const t_mx_needle *needle,
+                        const char *replace) {
+    MX_PROBE();
+    if (str == NULL || needle == NULL || replace == NULL) {
+        return NULL;
     }
 
-    int sub_len = mx_strlen(sub);
-    int replace_len = mx_strlen(replace);
-    int new_len = mx_strlen(str) + sub_count * (replace_len - sub_len);
+    return replace_core(str, needle, &replace, 1);
+}
 
-    char *result = mx_strnew(new_len);
-    if (result == NULL) {
+char *mx_replace_substrs(const char *str, const char *const *subs,
+                         const char *const *replaces, int count) {
+    MX_PROBE();
+    if (str == NULL || subs == NULL || replaces == NULL || count < 0) {
         return NULL;
     }
 
-    int i = 0;
-    int j = 0;
-
-    while (str[i]) {
-        if (mx_strstr(str + i, sub) == str + i) {
-            mx_strcpy(result + j, replace);
-            i += sub_len;
-            j += replace_len;
-        } else {
-            result[j++] = str[i++];
+    for (int i = 0; i < count; i++) {
+        if (subs[i] == NULL || replaces[i] == NULL) {
+            return NULL;
         }
     }
 
+    t_mx_needle *needles = MX_MALLOC((count ? count : 1) * sizeof(t_mx_needle));
+    if (needles == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < count; i++) {
+        mx_needle_init(&needles[i], subs[i], mx_strlen(subs[i]));
+    }
+
+    char *result = replace_core(str, needles, replaces, count);
+    MX_FREE(needles);
     return result;
 }
 
+/*
+ * Reads one byte at a time, so nothing past the delimiter is consumed
+ * and the descriptor stays usable with read() or another reader. Use a
+ * t_mx_reader for buffered reading.
+ */
 int mx_read_line(char **lineptr, size_t buf_size, char delim, const int fd) {
+    MX_PROBE();
     if (lineptr == NULL || buf_size == 0 || fd < 0) {
         return -2; 
     }
 
-    
-    if (*lineptr == NULL) {
-        *lineptr = (char *)malloc(buf_size);
-        if (*lineptr == NULL) {
-            return -2; 
-        }
+    char *buf = mx_realloc_grow(*lineptr, buf_size);
+    if (buf == NULL) {
+        return -2;
     }
+    *lineptr = buf;
+    size_t cap = malloc_usable_size(buf);
 
     size_t i = 0;
     char c;
+    ssize_t got;
 
-    while (read(fd, &c, 1) > 0) {
-        if (c == delim) { 
-            break; 
-        }
-
-        (*lineptr)[i] = c; 
-        i++;
-
-        
-        if (i == buf_size) {
-            char *new_buf = (char *)malloc(buf_size * 2);
-            if (new_buf == NULL) {
-                
-                return -2; 
-            }
-
-            for (size_t j = 0; j < buf_size; j++) {
-                new_buf[j] = (*lineptr)[j]; 
+    while ((got = read(fd, &c, 1)) > 0 && c != delim) {
+        if (i + 1 == cap) {
+            buf = mx_realloc_grow(*lineptr, cap * 2);
+            if (buf == NULL) {
+                return -2;
             }
-            free(*lineptr); 
-            *lineptr = new_buf; 
-            buf_size *= 2; 
+            *lineptr = buf;
+            cap = malloc_usable_size(buf);
         }
+        buf[i++] = c;
     }
 
-    
-    if (i == 0 && read(fd, &c, 1) <= 0) {
-        free(*lineptr);
+    if (got <= 0 && i == 0) {
+        MX_FREE(*lineptr);
         *lineptr = NULL; 
         return -1; 
     }
-
-    (*lineptr)[i] = '\0'; 
+    buf[i] = '\0';
 
     
-    if (i > 0 && (*lineptr)[i - 1] == '\n') {
-        (*lineptr)[i - 1] = '\0'; 
+    if (i > 0 && buf[i - 1] == '\n') {
+        buf[i - 1] = '\0'; 
         return i - 1; 
     }
 
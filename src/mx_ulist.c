@@ -0,0 +1,261 @@
+/**
+ * @file mx_ulist.c
+ * @brief Unrolled list: a deque of cache-line aligned chunks of elements.
+ *
+ * Each chunk is MX_ULIST_CHUNK_BYTES long, aligned to a cache line and
+ * holds MX_ULIST_ITEMS data pointers, so walking the list touches one
+ * new cache line per several elements instead of one per element as a
+ * t_list does. Elements live in items[start, start + count) of each
+ * chunk. Pushing at the back fills a chunk upwards and pushing at the
+ * front fills it downwards, so both ends are O(1).
+ *
+ * Functions:
+ * - void mx_ulist_init(t_mx_ulist *list): Initializes an empty list.
+ * - int mx_ulist_push_back(t_mx_ulist *list, void *data): Appends data.
+ * - int mx_ulist_push_front(t_mx_ulist *list, void *data): Prepends data.
+ * - void *mx_ulist_pop_back(t_mx_ulist *list): Removes and returns the last element.
+ * - void *mx_ulist_pop_front(t_mx_ulist *list): Removes and returns the first element.
+ * - void mx_ulist_iter(const t_mx_ulist *list, t_mx_uiter *it): Starts an iteration.
+ * - bool mx_ulist_next(t_mx_uiter *it, void **data): Yields the next element.
+ * - void *mx_ulist_find(const t_mx_ulist *list, const void *key, int (*cmp)(const void *, const void *)): Finds the first element equal to key.
+ * - int mx_ulist_sort(t_mx_ulist *list, int (*cmp)(const void *, const void *)): Sorts the elements.
+ * - int mx_ulist_from_list(t_mx_ulist *list, t_list *lst): Appends the data of a t_list.
+ * - t_list *mx_ulist_to_list(const t_mx_ulist *list): Builds a t_list with the same data.
+ * - void mx_ulist_clear(t_mx_ulist *list): Frees every chunk.
+ */
+
+#include "../inc/libmx.h"
+
+#define MX_CACHE_LINE 64
+
+static t_mx_uchunk *chunk_new(unsigned int start) {
+    t_mx_uchunk *chunk = (t_mx_uchunk *)MX_ALIGNED_ALLOC(MX_CACHE_LINE,
+                                                        sizeof(t_mx_uchunk));
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->prev = NULL;
+    chunk->start = start;
+    chunk->count = 0;
+    return chunk;
+}
+
+void mx_ulist_init(t_mx_ulist *list) {
+    if (list == NULL) {
+        return;
+    }
+    list->head = NULL;
+    list->tail = NULL;
+    list->size = 0;
+}
+
+int mx_ulist_push_back(t_mx_ulist *list, void *data) {
+    MX_PROBE();
+    if (list == NULL) {
+        return -1;
+    }
+    t_mx_uchunk *tail = list->tail;
+    if (tail == NULL || tail->start + tail->count == MX_ULIST_ITEMS) {
+        t_mx_uchunk *chunk = chunk_new(0);
+        if (chunk == NULL) {
+            return -1;
+        }
+        chunk->prev = tail;
+        if (tail == NULL) {
+            list->head = chunk;
+        } else {
+            tail->next = chunk;
+        }
+        list->tail = tail = chunk;
+    }
+    tail->items[tail->start + tail->count++] = data;
+    list->size++;
+    return 0;
+}
+
+int mx_ulist_push_front(t_mx_ulist *list, void *data) {
+    MX_PROBE();
+    if (list == NULL) {
+        return -1;
+    }
+    t_mx_uchunk *head = list->head;
+    if (head == NULL || head->start == 0) {
+        t_mx_uchunk *chunk = chunk_new(MX_ULIST_ITEMS);
+        if (chunk == NULL) {
+            return -1;
+        }
+        chunk->next = head;
+        if (head == NULL) {
+            list->tail = chunk;
+        } else {
+            head->prev = chunk;
+        }
+        list->head = head = chunk;
+    }
+    head->items[--head->start] = data;
+    head->count++;
+    list->size++;
+    return 0;
+}
+
+static void chunk_unlink(t_mx_ulist *list, t_mx_uchunk *chunk) {
+    if (chunk->prev == NULL) {
+        list->head = chunk->next;
+    } else {
+        chunk->prev->next = chunk->next;
+    }
+    if (chunk->next == NULL) {
+        list->tail = chunk->prev;
+    } else {
+        chunk->next->prev = chunk->prev;
+    }
+    MX_FREE(chunk);
+}
+
+void *mx_ulist_pop_back(t_mx_ulist *list) {
+    MX_PROBE();
+    if (list == NULL || list->tail == NULL) {
+        return NULL;
+    }
+    t_mx_uchunk *tail = list->tail;
+    void *data = tail->items[tail->start + --tail->count];
+    if (tail->count == 0) {
+        chunk_unlink(list, tail);
+    }
+    list->size--;
+    return data;
+}
+
+void *mx_ulist_pop_front(t_mx_ulist *list) {
+    MX_PROBE();
+    if (list == NULL || list->head == NULL) {
+        return NULL;
+    }
+    t_mx_uchunk *head = list->head;
+    void *data = head->items[head->start++];
+    if (--head->count == 0) {
+        chunk_unlink(list, head);
+    }
+    list->size--;
+    return data;
+}
+
+void mx_ulist_iter(const t_mx_ulist *list, t_mx_uiter *it) {
+    if (it == NULL) {
+        return;
+    }
+    it->chunk = list ? list->head : NULL;
+    it->idx = it->chunk ? it->chunk->start : 0;
+}
+
+bool mx_ulist_next(t_mx_uiter *it, void **data) {
+    if (it == NULL || it->chunk == NULL) {
+        return false;
+    }
+    if (data != NULL) {
+        *data = it->chunk->items[it->idx];
+    }
+    if (++it->idx == it->chunk->start + it->chunk->count) {
+        it->chunk = it->chunk->next;
+        it->idx = it->chunk ? it->chunk->start : 0;
+    }
+    return true;
+}
+
+// cmp receives an element's data and key, and returns 0 on a match
+void *mx_ulist_find(const t_mx_ulist *list, const void *key,
+                    int (*cmp)(const void *, const void *)) {
+    if (list == NULL || cmp == NULL) {
+        return NULL;
+    }
+    for (t_mx_uchunk *c = list->head; c != NULL; c = c->next) {
+        void **items = c->items + c->start;
+        for (unsigned int i = 0; i < c->count; i++) {
+            if (cmp(items[i], key) == 0) {
+                return items[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Gathers the elements into one array, sorts it with mx_sort and
+ * scatters them back. cmp compares element addresses like mx_sort does,
+ * i.e. it receives two void ** pointing into the array.
+ */
+int mx_ulist_sort(t_mx_ulist *list, int (*cmp)(const void *, const void *)) {
+    MX_PROBE();
+    if (list == NULL || cmp == NULL) {
+        return -1;
+    }
+    if (list->size < 2) {
+        return 0;
+    }
+
+    void **all = (void **)MX_MALLOC(list->size * sizeof(void *));
+    if (all == NULL) {
+        return -1;
+    }
+    size_t k = 0;
+    for (t_mx_uchunk *c = list->head; c != NULL; c = c->next) {
+        mx_memcpy(all + k, c->items + c->start, c->count * sizeof(void *));
+        k += c->count;
+    }
+    mx_sort(all, k, sizeof(void *), cmp);
+    k = 0;
+    for (t_mx_uchunk *c = list->head; c != NULL; c = c->next) {
+        mx_memcpy(c->items + c->start, all + k, c->count * sizeof(void *));
+        k += c->count;
+    }
+    MX_FREE(all);
+    return 0;
+}
+
+int mx_ulist_from_list(t_mx_ulist *list, t_list *lst) {
+    if (list == NULL) {
+        return -1;
+    }
+    for (t_list *node = lst; node != NULL; node = node->next) {
+        if (mx_ulist_push_back(list, node->data) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+t_list *mx_ulist_to_list(const t_mx_ulist *list) {
+    if (list == NULL) {
+        return NULL;
+    }
+    t_list *head = NULL;
+    t_list **link = &head;
+    for (t_mx_uchunk *c = list->head; c != NULL; c = c->next) {
+        for (unsigned int i = 0; i < c->count; i++) {
+            *link = mx_create_node(c->items[c->start + i]);
+            if (*link == NULL) {
+                while (head != NULL) {
+                    mx_pop_front(&head);
+                }
+                return NULL;
+            }
+            link = &(*link)->next;
+        }
+    }
+    return head;
+}
+
+void mx_ulist_clear(t_mx_ulist *list) {
+    MX_PROBE();
+    if (list == NULL) {
+        return;
+    }
+    t_mx_uchunk *c = list->head;
+    while (c != NULL) {
+        t_mx_uchunk *next = c->next;
+        MX_FREE(c);
+        c = next;
+    }
+    mx_ulist_init(list);
+}
@@ -0,0 +1,552 @@
+/**
+ * @file mx_utf8.c
+ * @brief UTF-8 validation, decoding, encoding and transcoding.
+ *
+ * Everything works on explicit lengths and caller buffers, so a large
+ * text can be validated or converted without allocating and a stream
+ * can be handled chunk by chunk. Valid means well-formed per Unicode:
+ * no overlong forms, no surrogate halves, nothing above U+10FFFF.
+ *
+ * Validation with AVX2 follows Keiser and Lemire: three 16-entry
+ * table lookups on the high and low nibbles of each byte and the high
+ * nibble of the next one classify every adjacent byte pair, and a
+ * saturating subtract finds the bytes that must be the third or fourth
+ * of a sequence. A 32-byte block costs a dozen instructions whatever
+ * its content, and pure ASCII blocks skip even that. Without AVX2 only
+ * ASCII runs are vectorized and other sequences are checked one by
+ * one. When a block fails, the scalar checker rescans it to report the
+ * exact offset.
+ *
+ * Functions:
+ * - size_t mx_utf8_encode(uint32_t cp, char *buf): Encodes a code point into buf, returns its length or 0 if it is not a Unicode scalar value.
+ * - int mx_utf8_decode(const char *s, size_t len, uint32_t *cp): Decodes one code point, returns the bytes used or -1.
+ * - size_t mx_utf8_validate(const char *s, size_t len): Length of the longest valid prefix of s.
+ * - bool mx_utf8_valid(const char *s, size_t len): Whether all of s is valid UTF-8.
+ * - size_t mx_utf8_count(const char *s, size_t len): Number of code points in valid UTF-8.
+ * - long mx_utf8_to_utf32(const char *s, size_t len, uint32_t *out, size_t out_len): Decodes s into out.
+ * - long mx_utf32_to_utf8(const uint32_t *in, size_t n, char *out, size_t out_len): Encodes in into out.
+ * - long mx_utf8_to_wcs(const char *s, size_t len, wchar_t *out, size_t out_len): mx_utf8_to_utf32 for wchar_t.
+ * - long mx_wcs_to_utf8(const wchar_t *in, size_t n, char *out, size_t out_len): mx_utf32_to_utf8 for wchar_t.
+ */
+
+#include "../inc/libmx.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MX_HAVE_X86 1
+#endif
+
+// wchar_t holds UTF-32 on every platform libmx builds on
+_Static_assert(sizeof(wchar_t) == sizeof(uint32_t), "wchar_t is not 32-bit");
+
+typedef size_t __attribute__((__may_alias__, __aligned__(1))) t_mx_uword;
+
+#define MX_WORD sizeof(size_t)
+#define MX_HIGHS ((size_t)-1 / 0xFF * 0x80)
+
+/*
+ * Decodes the sequence at s. The second byte's allowed range depends on
+ * the lead byte (Unicode table 3-7), which rules out overlong forms,
+ * surrogates and values above U+10FFFF without decoding first.
+ */
+static int decode(const unsigned char *s, size_t len, uint32_t *cp) {
+    unsigned char c = s[0];
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xBF;
+    int n;
+
+    if (c < 0x80) {
+        *cp = c;
+        return 1;
+    }
+    if (c < 0xC2 || c > 0xF4) {
+        return -1;
+    }
+    if (c < 0xE0) {
+        n = 2;
+        *cp = c & 0x1F;
+    } else if (c < 0xF0) {
+        n = 3;
+        *cp = c & 0x0F;
+        lo = c == 0xE0 ? 0xA0 : lo;
+        hi = c == 0xED ? 0x9F : hi;
+    } else {
+        n = 4;
+        *cp = c & 0x07;
+        lo = c == 0xF0 ? 0x90 : lo;
+        hi = c == 0xF4 ? 0x8F : hi;
+    }
+    if ((size_t)n > len || s[1] < lo || s[1] > hi) {
+        return -1;
+    }
+    *cp = (*cp << 6) | (s[1] & 0x3F);
+    for (int i = 2; i < n; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            return -1;
+        }
+        *cp = (*cp << 6) | (s[i] & 0x3F);
+    }
+    return n;
+}
+
+// Kernels: length of the leading ASCII run, validation, code point count
+
+static size_t ascii_word(const unsigned char *s, size_t len) {
+    size_t i = 0;
+
+    for (; i + MX_WORD <= len; i += MX_WORD) {
+        if (*(const t_mx_uword *)(s + i) & MX_HIGHS) {
+            break;
+        }
+    }
+    while (i < len && s[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+static inline size_t validate_with(const unsigned char *s, size_t len,
+                                   size_t (*ascii)(const unsigned char *,
+                                                   size_t)) {
+    size_t i = 0;
+    uint32_t cp;
+
+    while (i < len) {
+        if (s[i] < 0x80) {
+            i += ascii(s + i, len - i);
+            continue;
+        }
+        int n = decode(s + i, len - i, &cp);
+        if (n < 0) {
+            return i;
+        }
+        i += n;
+    }
+    return len;
+}
+
+static size_t validate_word(const unsigned char *s, size_t len) {
+    return validate_with(s, len, ascii_word);
+}
+
+static size_t count_word(const unsigned char *s, size_t len) {
+    size_t n = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        n += (s[i] & 0xC0) != 0x80;
+    }
+    return n;
+}
+
+#ifdef MX_HAVE_X86
+
+__attribute__((target("sse2")))
+static size_t ascii_sse2(const unsigned char *s, size_t len) {
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_loadu_si128((const __m128i *)(s + i)));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + ascii_word(s + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static size_t validate_sse2(const unsigned char *s, size_t len) {
+    return validate_with(s, len, ascii_sse2);
+}
+
+// Continuation bytes are 0x80..0xBF, the only ones below -64 as signed
+__attribute__((target("sse2")))
+static size_t count_sse2(const unsigned char *s, size_t len) {
+    __m128i cont = _mm_set1_epi8(-65);
+    size_t n = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        n += __builtin_popcount((unsigned)_mm_movemask_epi8(
+            _mm_cmpgt_epi8(v, cont)));
+    }
+    return n + count_word(s + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t ascii_avx2(const unsigned char *s, size_t len) {
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_loadu_si256((const __m256i *)(s + i)));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + ascii_word(s + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t count_avx2(const unsigned char *s, size_t len) {
+    __m256i cont = _mm256_set1_epi8(-65);
+    size_t n = 0;
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+        n += __builtin_popcount((unsigned)_mm256_movemask_epi8(
+            _mm256_cmpgt_epi8(v, cont)));
+    }
+    return n + count_word(s + i, len - i);
+}
+
+// Error classes of a byte pair, one bit each
+#define U8_TOO_SHORT   (1 << 0)  // lead or ASCII followed by a lead or ASCII
+#define U8_TOO_LONG    (1 << 1)  // ASCII followed by a continuation
+#define U8_OVERLONG_3  (1 << 2)
+#define U8_TOO_LARGE   (1 << 3)
+#define U8_SURROGATE   (1 << 4)
+#define U8_OVERLONG_2  (1 << 5)
+#define U8_TOO_LARGE_1000 (1 << 6)
+#define U8_OVERLONG_4  (1 << 6)
+#define U8_TWO_CONTS   (1 << 7)  // continuation followed by continuation
+#define U8_CARRY (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+static const unsigned char byte_1_high_tab[16] = {
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+    U8_TOO_SHORT | U8_OVERLONG_2,
+    U8_TOO_SHORT,
+    U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+    U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4
+};
+
+static const unsigned char byte_1_low_tab[16] = {
+    U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,
+    U8_CARRY | U8_OVERLONG_2,
+    U8_CARRY,
+    U8_CARRY,
+    U8_CARRY | U8_TOO_LARGE,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000
+};
+
+static const unsigned char byte_2_high_tab[16] = {
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3
+        | U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT
+};
+
+typedef struct  s_u8_state {
+    __m256i prev;
+    __m256i incomplete;
+    __m256i error;
+}               t_u8_state;
+
+__attribute__((target("avx2")))
+static inline __m256i high_nibbles(__m256i v) {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i table16(const unsigned char *tab) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)tab));
+}
+
+// The block shifted right by n bytes, with prev's last bytes shifted in
+__attribute__((target("avx2")))
+static inline __m256i shift_in(__m256i in, __m256i prev, int n) {
+    __m256i cross = _mm256_permute2x128_si256(prev, in, 0x21);
+    switch (n) {
+    case 1: return _mm256_alignr_epi8(in, cross, 15);
+    case 2: return _mm256_alignr_epi8(in, cross, 14);
+    default: return _mm256_alignr_epi8(in, cross, 13);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void check_block(t_u8_state *st, __m256i in) {
+    if (_mm256_movemask_epi8(in) == 0) {
+        st->error = _mm256_or_si256(st->error, st->incomplete);
+        st->incomplete = _mm256_setzero_si256();
+        st->prev = in;
+        return;
+    }
+
+    const __m256i byte_1_high = table16(byte_1_high_tab);
+    const __m256i byte_1_low = table16(byte_1_low_tab);
+    const __m256i byte_2_high = table16(byte_2_high_tab);
+
+    __m256i prev1 = shift_in(in, st->prev, 1);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(byte_1_high, high_nibbles(prev1)),
+            _mm256_shuffle_epi8(byte_1_low,
+                                _mm256_and_si256(prev1,
+                                                 _mm256_set1_epi8(0x0F)))),
+        _mm256_shuffle_epi8(byte_2_high, high_nibbles(in)));
+
+    // Only a 111_____ byte two back or 1111____ three back sets bit 7
+    __m256i third = _mm256_subs_epu8(shift_in(in, st->prev, 2),
+                                     _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(shift_in(in, st->prev, 3),
+                                      _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                      _mm256_set1_epi8((char)0x80));
+    st->error = _mm256_or_si256(st->error, _mm256_xor_si256(must23, special));
+
+    // A lead byte too close to the end needs the next block to finish
+    const __m256i max_tail = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    st->incomplete = _mm256_subs_epu8(in, max_tail);
+    st->prev = in;
+}
+
+/*
+ * Blocks are checked until one fails. The tail is checked as a block
+ * padded with zero bytes, which also flags a sequence cut off by the
+ * end of s. On failure the scalar checker takes over from the start of
+ * the first sequence that can reach into the failing block.
+ */
+__attribute__((target("avx2")))
+static size_t validate_avx2(const unsigned char *s, size_t len) {
+    t_u8_state st = {_mm256_setzero_si256(), _mm256_setzero_si256(),
+                     _mm256_setzero_si256()};
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        check_block(&st, _mm256_loadu_si256((const __m256i *)(s + i)));
+        if (!_mm256_testz_si256(st.error, st.error)) {
+            break;
+        }
+    }
+    if (i + 32 > len) {
+        unsigned char tail[32] = {0};
+        mx_memcpy(tail, s + i, len - i);
+        check_block(&st, _mm256_loadu_si256((const __m256i *)tail));
+        if (_mm256_testz_si256(st.error, st.error)) {
+            return len;
+        }
+    }
+
+    size_t from = i >= 3 ? i - 3 : 0;
+    while (from < i && (s[from] & 0xC0) == 0x80) {
+        from++;
+    }
+    return from + validate_word(s + from, len - from);
+}
+
+#endif /* MX_HAVE_X86 */
+
+// Kernel table, upgraded from CPUID at load time like mx_memory.c's
+static struct {
+    size_t (*ascii)(const unsigned char *, size_t);
+    size_t (*validate)(const unsigned char *, size_t);
+    size_t (*count)(const unsigned char *, size_t);
+} utf8_ops = {ascii_word, validate_word, count_word};
+
+__attribute__((constructor))
+static void utf8_ops_init(void) {
+#ifdef MX_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        utf8_ops.ascii = ascii_avx2;
+        utf8_ops.validate = validate_avx2;
+        utf8_ops.count = count_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        utf8_ops.ascii = ascii_sse2;
+        utf8_ops.validate = validate_sse2;
+        utf8_ops.count = count_sse2;
+    }
+#endif
+}
+
+size_t mx_utf8_encode(uint32_t cp, char *buf) {
+    if (cp < 0x80) {
+        buf[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        buf[0] = (char)(0xC0 | (cp >> 6));
+        buf[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        if (cp >= 0xD800 && cp <= 0xDFFF) {
+            return 0;
+        }
+        buf[0] = (char)(0xE0 | (cp >> 12));
+        buf[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    if (cp <= 0x10FFFF) {
+        buf[0] = (char)(0xF0 | (cp >> 18));
+        buf[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        buf[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[3] = (char)(0x80 | (cp & 0x3F));
+        return 4;
+    }
+    return 0;
+}
+
+int mx_utf8_decode(const char *s, size_t len, uint32_t *cp) {
+    uint32_t tmp;
+
+    if (s == NULL || len == 0) {
+        return -1;
+    }
+    return decode((const unsigned char *)s, len, cp ? cp : &tmp);
+}
+
+/*
+ * A prefix shorter than len ends just before the first bad sequence.
+ * For a chunked stream, a cut-off sequence at the end of a chunk also
+ * stops the prefix: carry the (at most 3) remaining bytes over into the
+ * next chunk and only report an error once no more input follows.
+ */
+size_t mx_utf8_validate(const char *s, size_t len) {
+    if (s == NULL) {
+        return 0;
+    }
+    return utf8_ops.validate((const unsigned char *)s, len);
+}
+
+bool mx_utf8_valid(const char *s, size_t len) {
+    return s != NULL && mx_utf8_validate(s, len) == len;
+}
+
+// Counts lead bytes, so invalid input gives a meaningless but safe result
+size_t mx_utf8_count(const char *s, size_t len) {
+    if (s == NULL) {
+        return 0;
+    }
+    return utf8_ops.count((const unsigned char *)s, len);
+}
+
+/*
+ * Returns the number of code points written, -1 when s is not valid
+ * UTF-8 and -2 when out_len is too small. With out NULL nothing is
+ * written and the number of code points s holds is returned.
+ *
+ * s is validated up front with the vector kernel, which lets the
+ * decoding loop trust every lead byte and skip the range checks.
+ */
+long mx_utf8_to_utf32(const char *s, size_t len, uint32_t *out,
+                      size_t out_len) {
+    const unsigned char *p = (const unsigned char *)s;
+    size_t i = 0;
+    size_t n = 0;
+
+    if (s == NULL || utf8_ops.validate(p, len) != len) {
+        return -1;
+    }
+    if (out == NULL) {
+        return (long)utf8_ops.count(p, len);
+    }
+
+    while (i < len) {
+        if (n == out_len) {
+            return -2;
+        }
+        unsigned char c = p[i];
+        if (c < 0x80) {
+            // Short runs between other scripts' letters skip the kernel
+            size_t run = 1;
+            if (len - i >= MX_WORD
+                && !(*(const t_mx_uword *)(p + i) & MX_HIGHS)) {
+                run = utf8_ops.ascii(p + i, len - i);
+                if (run > out_len - n) {
+                    return -2;
+                }
+            }
+            for (size_t k = 0; k < run; k++) {
+                out[n + k] = p[i + k];
+            }
+            i += run;
+            n += run;
+        } else if (c < 0xE0) {
+            out[n++] = ((uint32_t)(c & 0x1F) << 6) | (p[i + 1] & 0x3F);
+            i += 2;
+        } else if (c < 0xF0) {
+            out[n++] = ((uint32_t)(c & 0x0F) << 12)
+                       | ((uint32_t)(p[i + 1] & 0x3F) << 6)
+                       | (p[i + 2] & 0x3F);
+            i += 3;
+        } else {
+            out[n++] = ((uint32_t)(c & 0x07) << 18)
+                       | ((uint32_t)(p[i + 1] & 0x3F) << 12)
+                       | ((uint32_t)(p[i + 2] & 0x3F) << 6)
+                       | (p[i + 3] & 0x3F);
+            i += 4;
+        }
+    }
+    return (long)n;
+}
+
+/*
+ * Returns the number of bytes written, -1 when in holds a value that
+ * is not a Unicode scalar value and -2 when out_len is too small. With
+ * out NULL nothing is written and the length of the encoding is
+ * returned. No terminator is added.
+ */
+long mx_utf32_to_utf8(const uint32_t *in, size_t n, char *out,
+                      size_t out_len) {
+    char buf[MX_UTF8_MAX];
+    size_t len = 0;
+
+    if (in == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (in[i] < 0x80 && out != NULL) {
+            if (len == out_len) {
+                return -2;
+            }
+            out[len++] = (char)in[i];
+            continue;
+        }
+
+        bool direct = out != NULL && out_len - len >= MX_UTF8_MAX;
+        size_t k = mx_utf8_encode(in[i], direct ? out + len : buf);
+        if (k == 0) {
+            return -1;
+        }
+        if (out != NULL && !direct) {
+            if (k > out_len - len) {
+                return -2;
+            }
+            mx_memcpy(out + len, buf, k);
+        }
+        len += k;
+    }
+    return (long)len;
+}
+
+long mx_utf8_to_wcs(const char *s, size_t len, wchar_t *out,
+                    size_t out_len) {
+    return mx_utf8_to_utf32(s, len, (uint32_t *)out, out_len);
+}
+
+long mx_wcs_to_utf8(const wchar_t *in, size_t n, char *out, size_t out_len) {
+    return mx_utf32_to_utf8((const uint32_t *)in, n, out, out_len);
+}
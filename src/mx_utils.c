@@ -34,7 +34,7 @@
     * @c: The character to print.
 */
 void mx_printchar(char c) {
-    write(1, &c, 1);
+    mx_out_putc(c);
 }
 
 /**
@@ -42,21 +42,10 @@ void mx_printchar(char c) {
     * @c: The Unicode character to print.
 */
 void mx_print_unicode(wchar_t c) {
-    if (c <= 0x7F) {
-        mx_printchar(c);
-    } else if (c <= 0x7FF) {
-        mx_printchar(0xC0 | (c >> 6));
-        mx_printchar(0x80 | (c & 0x3F));
-    } else if (c <= 0xFFFF) {
-        mx_printchar(0xE0 | (c >> 12));
-        mx_printchar(0x80 | ((c >> 6) & 0x3F));
-        mx_printchar(0x80 | (c & 0x3F));
-    } else if (c <= 0x10FFFF) {
-        mx_printchar(0xF0 | (c >> 18));
-        mx_printchar(0x80 | ((c >> 12) & 0x3F));
-        mx_printchar(0x80 | ((c >> 6) & 0x3F));
-        mx_printchar(0x80 | (c & 0x3F));
-    }
+    char buf[MX_UTF8_MAX];
+
+    // Surrogate halves and values past U+10FFFF print nothing
+    mx_out_write(buf, mx_utf8_encode((uint32_t)c, buf));
 }
 
 
@@ -69,12 +58,7 @@ void mx_printstr(const char *s) {
         return;
     }
 
-    int count = 0;
-
-    while (s[count] != '\0') {
-        mx_printchar(s[count]);
-        count++;
-    }
+    mx_out_write(s, mx_strlen(s));
 }
 
 void mx_print_strarr(char **arr, const char *delim) {
@@ -92,21 +76,9 @@ void mx_print_strarr(char **arr, const char *delim) {
 }
 
 void mx_printint(int n) {
-    if (n < 0) {
-        mx_printchar('-');
-        if (n == INT_MIN) {
-            mx_printchar('2');
-            n = 147483648;
-        } else {
-            n = -n;
-        }
-    }
+    char buf[MX_NBR_BUF];
 
-    if (n >= 10) {
-        mx_printint(n / 10);
-    }
-
-    mx_printchar((n % 10) + '0');
+    mx_out_write(buf, mx_i64_to_buf(n, buf));
 }
 
 
@@ -139,39 +111,10 @@ int mx_sqrt(int x) {
 }
 
 char *mx_nbr_to_hex(unsigned long nbr) {
-    if (nbr == 0) {
-        char *zero = (char *)malloc(2);
-        zero[0] = '0';
-        zero[1] = '\0';
-        return zero;
-    }
-
-    unsigned long temp = nbr;
-    int len = 0;
-
-    while (temp > 0) {
-        temp /= 16;
-        len++;
-    }
-
-    char *hex = (char *)malloc(len + 1);
-    if (hex == NULL) {
-        return NULL;
-    }
+    char buf[MX_NBR_BUF];
+    size_t len = mx_hex_to_buf(nbr, buf);
 
-    hex[len] = '\0';
-
-    while (nbr > 0) {
-        unsigned long remain = nbr % 16;
-        if (remain < 10) {
-            hex[--len] = '0' + remain;
-        } else {
-            hex[--len] = 'a' + (remain - 10);
-        }
-        nbr /= 16;
-    }
-
-    return hex;
+    return mx_strndup(buf, len);
 }
 
 unsigned long mx_hex_to_nbr(const char *hex) {
@@ -200,33 +143,10 @@ unsigned long mx_hex_to_nbr(const char *hex) {
 
 
 char *mx_itoa(int number) {
-    if (number == INT_MIN) {
-        return mx_strdup("-2147483648");
-    }
-
-    int len = 1;
-    int temp = number;
-
-    while (temp /= 10) {
-        len++;
-    }
-
-    char *result = mx_strnew(len + (number < 0 ? 1 : 0));
-    if (result == NULL) {
-        return NULL;
-    }
-
-    if (number < 0) {
-        result[0] = '-';
-        number = -number;
-    }
-
-    for (int i = len - 1; i >= 0; i--) {
-        result[i + (result[0] == '-')] = number % 10 + '0';
-        number /= 10;
-    }
+    char buf[MX_NBR_BUF];
+    size_t len = mx_i64_to_buf(number, buf);
 
-    return result;
+    return mx_strndup(buf, len);
 }
 
 void mx_foreach(int *arr, int size, void (*f)(int)) {
@@ -250,7 +170,7 @@ int mx_binary_search(char **arr, int size, const char *s, int *count) {
 
     while (left <= right) {
         (*count)++;
-        int mid = (left + right) / 2;
+        int mid = left + (right - left) / 2;
         int cmp = mx_strcmp(arr[mid], s);
 
         if (cmp == 0) {
@@ -266,11 +186,24 @@ int mx_binary_search(char **arr, int size, const char *s, int *count) {
     return -1;  
 }
 
+static int cmp_strptr(const void *a, const void *b) {
+    return mx_strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/*
+ * The swap count of bubble sort equals the number of inversions, which
+ * mx_stable_sort counts in O(n log n) while producing the same order.
+ */
 int mx_bubble_sort(char **arr, int size) {
     if (!arr || size <= 1) {
         return 0;
     }
 
+    long inversions = mx_stable_sort(arr, size, sizeof(char *), cmp_strptr);
+    if (inversions >= 0) {
+        return (int)inversions;
+    }
+
     int swaps = 0;
     for (int i = 0; i < size - 1; i++) {
         for (int j = 0; j < size - 1 - i; j++) {
@@ -288,44 +221,75 @@ int mx_bubble_sort(char **arr, int size) {
 
 
 
-int mx_quicksort(char **arr, int left, int right) {
-    if (!arr || left < 0 || right < 0) {
-        return -1;
-    }
-
+/*
+ * Same partitioning as always, so results and swap counts are unchanged,
+ * but lengths are measured once up front (lens[k] belongs to arr[base + k],
+ * or is recomputed when lens is NULL) and only the smaller side recurses.
+ */
+static int quicksort_core(char **arr, int *lens, int base, int left, int right) {
     int swaps = 0;
-    int i = left;
-    int j = right;
-    int pivot = mx_strlen(arr[(left + right) / 2]);
 
-    while (i <= j) {
-        while (mx_strlen(arr[i]) < pivot) {
-            i++;
-        }
+    while (left < right) {
+        int i = left;
+        int j = right;
+        int mid = left + (right - left) / 2;
+        int pivot = lens ? lens[mid - base] : mx_strlen(arr[mid]);
 
-        while (mx_strlen(arr[j]) > pivot) {
-            j--;
-        }
+        while (i <= j) {
+            while ((lens ? lens[i - base] : mx_strlen(arr[i])) < pivot) {
+                i++;
+            }
 
-        if (i <= j) {
-            if (i != j) {
-                char *temp = arr[i];
-                arr[i] = arr[j];
-                arr[j] = temp;
-                swaps++;
+            while ((lens ? lens[j - base] : mx_strlen(arr[j])) > pivot) {
+                j--;
+            }
+
+            if (i <= j) {
+                if (i != j) {
+                    char *temp = arr[i];
+                    arr[i] = arr[j];
+                    arr[j] = temp;
+                    if (lens) {
+                        int len = lens[i - base];
+                        lens[i - base] = lens[j - base];
+                        lens[j - base] = len;
+                    }
+                    swaps++;
+                }
+                i++;
+                j--;
             }
-            i++;
-            j--;
+        }
+
+        if (j - left < right - i) {
+            swaps += quicksort_core(arr, lens, base, left, j);
+            left = i;
+        } else {
+            swaps += quicksort_core(arr, lens, base, i, right);
+            right = j;
         }
     }
 
-    if (left < j) {
-        swaps += mx_quicksort(arr, left, j);
+    return swaps;
+}
+
+int mx_quicksort(char **arr, int left, int right) {
+    MX_PROBE();
+    if (!arr || left < 0 || right < 0) {
+        return -1;
+    }
+    if (left >= right) {
+        return 0;
     }
 
-    if (i < right) {
-        swaps += mx_quicksort(arr, i, right);
+    int *lens = (int *)MX_MALLOC((right - left + 1) * sizeof(int));
+    if (lens != NULL) {
+        for (int k = left; k <= right; k++) {
+            lens[k - left] = mx_strlen(arr[k]);
+        }
     }
 
+    int swaps = quicksort_core(arr, lens, left, left, right);
+    MX_FREE(lens);
     return swaps;
 }
@@ -0,0 +1,68 @@
+/**
+ * @file test.c
+ * @brief Failure reporting and heap accounting shared by the tests.
+ */
+
+#include "test.h"
+#include <stdarg.h>
+
+// Failures are printed only up to this many, the rest just counted
+#define TEST_MAX_REPORTS 20
+
+static atomic_long failures = 0;
+static atomic_long live_blocks = 0;
+
+void *__real_malloc(size_t size);
+void *__real_aligned_alloc(size_t align, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+    void *ptr = __real_malloc(size);
+    if (ptr != NULL) {
+        atomic_fetch_add_explicit(&live_blocks, 1, memory_order_relaxed);
+    }
+    return ptr;
+}
+
+void *__wrap_aligned_alloc(size_t align, size_t size) {
+    void *ptr = __real_aligned_alloc(align, size);
+    if (ptr != NULL) {
+        atomic_fetch_add_explicit(&live_blocks, 1, memory_order_relaxed);
+    }
+    return ptr;
+}
+
+void __wrap_free(void *ptr) {
+    if (ptr != NULL) {
+        atomic_fetch_sub_explicit(&live_blocks, 1, memory_order_relaxed);
+    }
+    __real_free(ptr);
+}
+
+void test_fail(const char *file, int line, const char *fmt, ...) {
+    if (atomic_fetch_add(&failures, 1) >= TEST_MAX_REPORTS) {
+        return;
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "%s:%d: ", file, line);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+}
+
+long test_live_blocks(void) {
+    return atomic_load(&live_blocks);
+}
+
+int test_report(const char *name) {
+    long n = atomic_load(&failures);
+
+    printf("%-12s %s", name, n ? "FAILED" : "ok");
+    if (n) {
+        printf(" (%ld checks)", n);
+    }
+    putchar('\n');
+    return n ? 1 : 0;
+}
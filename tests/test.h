@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../inc/libmx.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Test harness. Every test is its own program: CHECK counts and prints
+ * failed conditions and test_report turns the count into the exit
+ * status. The linker routes libmx's malloc, aligned_alloc and free
+ * through counting wrappers (see test.c), so a test can tell whether
+ * the library leaked by comparing live blocks before and after.
+ */
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            test_fail(__FILE__, __LINE__, __VA_ARGS__); \
+        } \
+    } while (0)
+
+void test_fail(const char *file, int line, const char *fmt, ...);
+long test_live_blocks(void);
+int test_report(const char *name);
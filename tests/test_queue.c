@@ -0,0 +1,229 @@
+/**
+ * @file test_queue.c
+ * @brief Multi-producer/multi-consumer stress test of t_mx_queue and
+ *        t_mx_ring.
+ *
+ * Producers push distinct tagged items while consumers pop concurrently.
+ * Every item must arrive exactly once, and each consumer must see the
+ * items of any one producer in the order they were pushed. Hazard
+ * pointer records and their retired arrays outlive their threads and
+ * are reused, so a warm-up first has every thread both push and pop
+ * while all of them hold a record; after that, a run must leave the
+ * live block count where it found it.
+ */
+
+#define _GNU_SOURCE
+#include "test.h"
+#include <pthread.h>
+#include <sched.h>
+
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define PER_PRODUCER 100000
+#define ITEMS (PRODUCERS * PER_PRODUCER)
+// Small enough that producers regularly find the ring full
+#define RING_SLOTS 64
+
+typedef struct  s_stress {
+    t_mx_queue *queue;
+    t_mx_ring *ring;
+    atomic_long popped;
+    pthread_barrier_t done;
+    atomic_uchar seen[ITEMS];
+}               t_stress;
+
+typedef struct  s_worker {
+    t_stress *st;
+    int id;
+}               t_worker;
+
+static t_stress stress;
+
+static bool push(t_stress *st, void *data) {
+    if (st->ring != NULL) {
+        return mx_ring_push(st->ring, data);
+    }
+    return mx_queue_push(st->queue, data) == 0;
+}
+
+static bool pop(t_stress *st, void **data) {
+    if (st->ring != NULL) {
+        return mx_ring_pop(st->ring, data);
+    }
+    return mx_queue_pop(st->queue, data);
+}
+
+// Items are 1-based so that none of them is NULL
+static void *producer(void *arg) {
+    t_worker *w = arg;
+
+    for (long i = 0; i < PER_PRODUCER; i++) {
+        void *item = (void *)(uintptr_t)(w->id * PER_PRODUCER + i + 1);
+        while (!push(w->st, item)) {
+            sched_yield();
+        }
+    }
+    pthread_barrier_wait(&w->st->done);
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    t_worker *w = arg;
+    t_stress *st = w->st;
+    long last[PRODUCERS];
+
+    for (int p = 0; p < PRODUCERS; p++) {
+        last[p] = -1;
+    }
+    while (true) {
+        void *data;
+        if (!pop(st, &data)) {
+            if (atomic_load(&st->popped) == ITEMS) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        atomic_fetch_add(&st->popped, 1);
+
+        long item = (long)(uintptr_t)data - 1;
+        if (item < 0 || item >= ITEMS) {
+            CHECK(false, "consumer %d popped a foreign item %ld", w->id,
+                  item);
+            continue;
+        }
+        int p = (int)(item / PER_PRODUCER);
+        long seq = item % PER_PRODUCER;
+        CHECK(seq > last[p], "consumer %d saw producer %d's item %ld "
+              "after %ld", w->id, p, seq, last[p]);
+        last[p] = seq;
+        CHECK(atomic_fetch_add(&st->seen[item], 1) == 0,
+              "item %ld popped twice", item);
+    }
+    pthread_barrier_wait(&st->done);
+    return NULL;
+}
+
+static void run_round(t_stress *st, const char *what) {
+    pthread_t threads[PRODUCERS + CONSUMERS];
+    t_worker workers[PRODUCERS + CONSUMERS];
+
+    atomic_store(&st->popped, 0);
+    pthread_barrier_init(&st->done, NULL, PRODUCERS + CONSUMERS);
+    for (long i = 0; i < ITEMS; i++) {
+        atomic_store(&st->seen[i], 0);
+    }
+    for (int i = 0; i < PRODUCERS + CONSUMERS; i++) {
+        workers[i].st = st;
+        workers[i].id = i < PRODUCERS ? i : i - PRODUCERS;
+        pthread_create(&threads[i], NULL,
+                       i < PRODUCERS ? producer : consumer, &workers[i]);
+    }
+    for (int i = 0; i < PRODUCERS + CONSUMERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&st->done);
+
+    long missing = 0;
+    for (long i = 0; i < ITEMS; i++) {
+        missing += atomic_load(&st->seen[i]) == 0;
+    }
+    CHECK(missing == 0, "%s: %ld items never arrived", what, missing);
+    CHECK(!pop(st, NULL), "%s: queue not empty after the run", what);
+}
+
+// Nobody leaves before every thread has retired a node
+static void *warm_up_worker(void *arg) {
+    t_stress *st = arg;
+
+    mx_queue_push(st->queue, st);
+    while (!mx_queue_pop(st->queue, NULL)) {
+        sched_yield();
+    }
+    pthread_barrier_wait(&st->done);
+    return NULL;
+}
+
+static void warm_up(t_stress *st) {
+    pthread_t threads[PRODUCERS + CONSUMERS];
+
+    mx_queue_push(st->queue, st);
+    mx_queue_pop(st->queue, NULL);
+    pthread_barrier_init(&st->done, NULL, PRODUCERS + CONSUMERS);
+    for (int i = 0; i < PRODUCERS + CONSUMERS; i++) {
+        pthread_create(&threads[i], NULL, warm_up_worker, st);
+    }
+    for (int i = 0; i < PRODUCERS + CONSUMERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&st->done);
+}
+
+static void stress_queue(void) {
+    stress.ring = NULL;
+    stress.queue = mx_queue_new();
+    CHECK(stress.queue != NULL, "mx_queue_new failed");
+    if (stress.queue == NULL) {
+        return;
+    }
+    warm_up(&stress);
+    mx_queue_del(&stress.queue);
+
+    long live = test_live_blocks();
+    stress.queue = mx_queue_new();
+    run_round(&stress, "queue");
+    mx_queue_del(&stress.queue);
+    CHECK(test_live_blocks() == live, "queue leaked %ld blocks",
+          test_live_blocks() - live);
+}
+
+static void stress_ring(void) {
+    long live = test_live_blocks();
+
+    stress.queue = NULL;
+    stress.ring = mx_ring_new(RING_SLOTS);
+    CHECK(stress.ring != NULL, "mx_ring_new failed");
+    if (stress.ring == NULL) {
+        return;
+    }
+    run_round(&stress, "ring");
+    mx_ring_del(&stress.ring);
+    CHECK(test_live_blocks() == live, "ring leaked %ld blocks",
+          test_live_blocks() - live);
+}
+
+// Items still queued are freed with the queue
+static void *delete_nonempty(void *arg) {
+    t_mx_queue *queue = mx_queue_new();
+
+    (void)arg;
+    for (long i = 1; i <= 1000; i++) {
+        mx_queue_push(queue, (void *)(uintptr_t)i);
+    }
+    void *data;
+    for (long i = 1; i <= 500; i++) {
+        CHECK(mx_queue_pop(queue, &data) && data == (void *)(uintptr_t)i,
+              "single-threaded pop %ld out of order", i);
+    }
+    mx_queue_del(&queue);
+    CHECK(queue == NULL, "mx_queue_del left the pointer set");
+    return NULL;
+}
+
+// The thread's retired nodes are freed when it exits
+static void delete_in_thread(void) {
+    long live = test_live_blocks();
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, delete_nonempty, NULL);
+    pthread_join(thread, NULL);
+    CHECK(test_live_blocks() == live, "deleting a non-empty queue leaked "
+          "%ld blocks", test_live_blocks() - live);
+}
+
+int main(void) {
+    stress_queue();
+    stress_ring();
+    delete_in_thread();
+    return test_report("queue");
+}
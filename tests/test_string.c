@@ -0,0 +1,214 @@
+/**
+ * @file test_string.c
+ * @brief Equivalence tests of the string scanning kernels.
+ *
+ * Every strlen, strchrnul and strcmp kernel of mx_string.c, the word
+ * versions and whichever SIMD versions this CPU runs, is checked
+ * against a plain byte loop over all alignments within 64 bytes and
+ * lengths up to a few vectors. A second pass puts the strings right in
+ * front of an unmapped page, where a kernel reading one byte too far
+ * faults. The source is included so the static kernels are reachable.
+ */
+
+#define _GNU_SOURCE
+#include "../src/mx_string.c"
+#include "test.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MAX_ALIGN 64
+#define MAX_LEN 300
+// Enough room for any alignment, length and the terminator
+#define AREA (MAX_ALIGN + MAX_LEN + 1)
+
+typedef struct  s_kernel {
+    const char *name;
+    bool usable;
+    size_t (*len)(const char *);
+    const char *(*chrnul)(const char *, char);
+    size_t (*cmp)(const char *, const char *);
+}               t_kernel;
+
+static t_kernel kernels[] = {
+    {"word", true, strlen_word, strchrnul_word, strcmp_word},
+#ifdef MX_HAVE_X86
+    {"sse2", false, strlen_sse2, strchrnul_sse2, strcmp_sse2},
+    {"avx2", false, strlen_avx2, strchrnul_avx2, strcmp_avx2},
+#endif
+};
+
+#define N_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static size_t ref_len(const char *s) {
+    size_t i = 0;
+    while (s[i]) i++;
+    return i;
+}
+
+static const char *ref_chrnul(const char *s, char c) {
+    while (*s && *s != c) s++;
+    return s;
+}
+
+static size_t ref_cmp(const char *s1, const char *s2) {
+    size_t i = 0;
+    while (s1[i] == s2[i] && s1[i]) i++;
+    return i;
+}
+
+// Non-zero bytes, high ones included so sign extension would show
+static void fill(char *s, size_t len, unsigned seed) {
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245 + 12345;
+        s[i] = (char)(1 + (seed >> 16) % 255);
+    }
+    s[len] = '\0';
+}
+
+// s holds a string of len bytes; c is absent, at each end and inside
+static void check_one(const t_kernel *k, char *s, size_t len) {
+    CHECK(k->len(s) == ref_len(s), "%s strlen: align %zu len %zu",
+          k->name, (size_t)((uintptr_t)s % MAX_ALIGN), len);
+
+    char absent = (char)0x80;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == absent) {
+            s[i] = 'x';
+        }
+    }
+    CHECK(k->chrnul(s, absent) == s + len, "%s strchrnul (absent): "
+          "align %zu len %zu", k->name,
+          (size_t)((uintptr_t)s % MAX_ALIGN), len);
+    size_t at[] = {0, len / 2, len ? len - 1 : 0};
+    for (size_t j = 0; j < sizeof(at) / sizeof(at[0]) && len; j++) {
+        char c = s[at[j]];
+        CHECK(k->chrnul(s, c) == ref_chrnul(s, c), "%s strchrnul: "
+              "align %zu len %zu at %zu", k->name,
+              (size_t)((uintptr_t)s % MAX_ALIGN), len, at[j]);
+    }
+}
+
+// t is a copy of s; compares equal, then with each byte changed
+static void check_cmp(const t_kernel *k, const char *s, char *t,
+                      size_t len) {
+    CHECK(k->cmp(s, t) == len, "%s strcmp (equal): len %zu offsets "
+          "%zu/%zu", k->name, len, (size_t)((uintptr_t)s % MAX_ALIGN),
+          (size_t)((uintptr_t)t % MAX_ALIGN));
+    for (size_t i = 0; i < len; i++) {
+        char saved = t[i];
+        t[i] = saved == (char)0xFF ? 1 : saved + 1;
+        CHECK(k->cmp(s, t) == ref_cmp(s, t), "%s strcmp: len %zu "
+              "differs at %zu", k->name, len, i);
+        // t ends early
+        t[i] = '\0';
+        CHECK(k->cmp(s, t) == i, "%s strcmp: len %zu, other string "
+              "ends at %zu", k->name, len, i);
+        t[i] = saved;
+    }
+}
+
+static void check_aligned(const t_kernel *k) {
+    static _Alignas(MAX_ALIGN) char a[AREA];
+    static _Alignas(MAX_ALIGN) char b[AREA];
+
+    for (size_t len = 0; len <= MAX_LEN; len++) {
+        for (size_t off = 0; off < MAX_ALIGN; off++) {
+            fill(a + off, len, (unsigned)(len * MAX_ALIGN + off));
+            check_one(k, a + off, len);
+        }
+        // Both offsets vary, which is what the page checks depend on
+        for (size_t off = 0; off < MAX_ALIGN; off += 7) {
+            size_t off2 = (off * 5 + len) % MAX_ALIGN;
+            fill(a + off, len, (unsigned)len);
+            mx_memcpy(b + off2, a + off, len + 1);
+            check_cmp(k, a + off, b + off2, len);
+        }
+    }
+}
+
+// Two pages each, the second one unmapped
+static char *guarded(size_t page) {
+    char *area = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+        return NULL;
+    }
+    if (mprotect(area + page, page, PROT_NONE) != 0) {
+        munmap(area, 2 * page);
+        return NULL;
+    }
+    return area;
+}
+
+static void check_page_end(const t_kernel *k, char *p1, char *p2,
+                           size_t page) {
+    for (size_t len = 0; len <= MAX_LEN; len++) {
+        char *s = p1 + page - len - 1;
+        fill(s, len, (unsigned)len);
+        check_one(k, s, len);
+
+        // Both strings end at their page end, then only one of them
+        for (size_t shift = 0; shift < MAX_ALIGN; shift += 13) {
+            char *t = p2 + page - len - 1 - shift;
+            mx_memcpy(t, s, len + 1);
+            check_cmp(k, s, t, len);
+            check_cmp(k, t, s, len);
+        }
+    }
+}
+
+static void check_kernels(void) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char *p1 = guarded(page);
+    char *p2 = guarded(page);
+
+    CHECK(p1 != NULL && p2 != NULL, "cannot map guard pages");
+    for (size_t i = 0; i < N_KERNELS; i++) {
+        if (!kernels[i].usable) {
+            continue;
+        }
+        check_aligned(&kernels[i]);
+        if (p1 != NULL && p2 != NULL) {
+            check_page_end(&kernels[i], p1, p2, page);
+        }
+    }
+    if (p1 != NULL) {
+        munmap(p1, 2 * page);
+    }
+    if (p2 != NULL) {
+        munmap(p2, 2 * page);
+    }
+}
+
+// The public wrappers on whatever kernel the dispatcher picked
+static void check_public(void) {
+    char buf[64];
+
+    CHECK(mx_strlen("hello") == 5, "mx_strlen");
+    CHECK(mx_strlen("") == 0, "mx_strlen of an empty string");
+    CHECK(mx_strlen(NULL) == -2, "mx_strlen(NULL)");
+    CHECK(mx_strcmp("abc", "abd") < 0, "mx_strcmp less");
+    CHECK(mx_strcmp("abd", "abc") > 0, "mx_strcmp greater");
+    CHECK(mx_strcmp("abc", "abc") == 0, "mx_strcmp equal");
+    CHECK(mx_strcmp("ab", "abc") < 0, "mx_strcmp prefix");
+    CHECK(mx_get_char_index("hello", 'l') == 2, "mx_get_char_index");
+    CHECK(mx_get_char_index("hello", 'z') == -1,
+          "mx_get_char_index of a missing char");
+    CHECK(mx_get_char_index("hello", '\0') == -1,
+          "mx_get_char_index of the terminator");
+    CHECK(mx_strcpy(buf, "foo") == buf && strcmp(buf, "foo") == 0,
+          "mx_strcpy");
+    CHECK(mx_strcat(buf, "bar") == buf && strcmp(buf, "foobar") == 0,
+          "mx_strcat");
+}
+
+int main(void) {
+#ifdef MX_HAVE_X86
+    __builtin_cpu_init();
+    kernels[1].usable = __builtin_cpu_supports("sse2");
+    kernels[2].usable = __builtin_cpu_supports("avx2");
+#endif
+    check_kernels();
+    check_public();
+    return test_report("string");
+}